@@ -16,6 +16,8 @@
 
 #define LOG_TAG IntelCca
 
+#include <stdlib.h>
+
 #include <vector>
 
 #include "modules/algowrapper/IntelCca.h"
@@ -234,8 +236,10 @@ bool IntelCca::allocStatsDataMem(unsigned int size) {
 
     AutoMutex l(mMemStatsMLock);
     for (int i = 0; i < kMaxQueueSize; i++) {
-        void* p = malloc(size);
-        CheckAndLogError(!p, false, "failed to malloc stats buffer");
+        // Page aligned, so that p2p serializes the stats into whole pages
+        void* p = nullptr;
+        int ret = posix_memalign(&p, PAGE_SIZE_U, PAGE_ALIGN(size));
+        CheckAndLogError(ret != 0, false, "failed to alloc stats buffer, ret:%d", ret);
         StatsBufInfo info = {size, p, 0};
 
         int64_t index = i * (-1) - 1;  // default index list: -1, -2, -3, ...
@@ -18,10 +18,21 @@
 
 #include "modules/algowrapper/IntelTNR7US.h"
 
+#ifdef TNR7_CM
 #include <base/functional/bind.h>
 #include <base/threading/thread.h>
+#endif
 
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CPU_TNR_AVX2
+#endif
+
+#include <algorithm>
 #include <string>
+#include <thread>
 
 #include "iutils/CameraLog.h"
 #include "iutils/Utils.h"
@@ -31,10 +42,11 @@
 
 namespace icamera {
 
-IntelTNR7US* IntelTNR7US::createIntelTNR(int cameraId) {
+IntelTNR7US* IntelTNR7US::createIntelTNR(int cameraId, bool useCpuTnr) {
 #ifdef TNR7_CM
-    return new IntelC4mTNR(cameraId);
+    if (!useCpuTnr) return new IntelC4mTNR(cameraId);
 #endif
+    return new IntelCpuTNR(cameraId);
 }
 
 Tnr7Param* IntelTNR7US::allocTnr7ParamBuf() {
@@ -43,6 +55,312 @@ Tnr7Param* IntelTNR7US::allocTnr7ParamBuf() {
     return mTnrParam;
 }
 
+// Max weight of the reference frame in Q8 for the static pixels
+#define CPU_TNR_MAX_REF_WEIGHT 192
+// The motion threshold (pixel difference) at unit gain, and its range
+#define CPU_TNR_BASE_THRESHOLD 4
+#define CPU_TNR_MAX_THRESHOLD 48
+
+IntelCpuTNR::IntelCpuTNR(int cameraId)
+        : IntelTNR7US(cameraId),
+          mStride(0),
+          mBandCount(1),
+          mBandJobId(0),
+          mBandsPending(0),
+          mBandExit(false),
+          mInBuf(nullptr),
+          mOutBuf(nullptr),
+          mRefValid(false),
+          mGain(-1),
+          mThreshold(CPU_TNR_BASE_THRESHOLD),
+          mRefWeightSlope(0),
+          mUseAvx2(false) {
+    CLEAR(mRefWeightLut);
+#ifdef CPU_TNR_AVX2
+    mUseAvx2 = __builtin_cpu_supports("avx2");
+#endif
+}
+
+IntelCpuTNR::~IntelCpuTNR() {
+    stopBandThreads();
+    freeAllBufs();
+}
+
+int IntelCpuTNR::init(int width, int height, TnrType type) {
+    LOG1("<id:%d>@%s size %dx%d, type %d", mCameraId, __func__, width, height, type);
+    CheckAndLogError(width <= 0 || height <= 0 || (height % 2), BAD_VALUE,
+                     "%s, invalid size %dx%d", __func__, width, height);
+    // The threads of a previous init work on the old size, stop them before the reinit
+    stopBandThreads();
+    {
+        AutoMutex l(mBandLock);
+        mBandExit = false;
+        mBandJobId = 0;
+        mBandsPending = 0;
+    }
+
+    mWidth = width;
+    mHeight = height;
+    mTnrType = type;
+    // The same pitch as the GPU TNR, which takes the NV12 buffers without row padding
+    mStride = width;
+
+    int frameSize = mStride * mHeight * 3 / 2;
+    mRefBuf = std::unique_ptr<uint8_t[]>(new uint8_t[frameSize]);
+    mRefValid = false;
+    updateWeightLut(100);
+
+    int cpuCount = static_cast<int>(std::thread::hardware_concurrency());
+    mBandCount = std::max(1, std::min(cpuCount, kMaxBandCount));
+    // The calling thread blends band 0 itself
+    for (int band = 1; band < mBandCount; band++) {
+        std::unique_ptr<BandThread> thread(new BandThread(this, band));
+        std::string threadName = "CpuTNR" + std::to_string(type + (mCameraId << 1)) + "-" +
+                                 std::to_string(band);
+        thread->run(threadName, PRIORITY_NORMAL);
+        mBandThreads.push_back(std::move(thread));
+    }
+    LOG1("<id:%d>@%s stride %d, %d bands, avx2 %d", mCameraId, __func__, mStride, mBandCount,
+         mUseAvx2);
+
+    return OK;
+}
+
+void IntelCpuTNR::stopBandThreads() {
+    {
+        AutoMutex l(mBandLock);
+        mBandExit = true;
+        mBandStartSignal.broadcast();
+    }
+    for (auto& thread : mBandThreads) {
+        thread->requestExitAndWait();
+    }
+    mBandThreads.clear();
+}
+
+void* IntelCpuTNR::allocCamBuf(uint32_t bufSize, int id) {
+    LOG1("<%d>@%s, type %d, id: %d", mCameraId, __func__, mTnrType, id);
+    void* buffer = nullptr;
+    int ret = posix_memalign(&buffer, getpagesize(), bufSize);
+    CheckAndLogError(ret != 0, nullptr, "%s, posix_memalign fails, ret:%d", __func__, ret);
+
+    mCamBufs.push_back(buffer);
+    return buffer;
+}
+
+void IntelCpuTNR::freeAllBufs() {
+    LOG1("<%d>@%s, type %d", mCameraId, __func__, mTnrType);
+    for (auto buffer : mCamBufs) {
+        ::free(buffer);
+    }
+    mCamBufs.clear();
+    if (mTnrParam) {
+        delete mTnrParam;
+        mTnrParam = nullptr;
+    }
+}
+
+int IntelCpuTNR::asyncParamUpdate(int gain, bool forceUpdate) {
+    // The weight table is cheap to build, so update it in the caller thread
+    if (forceUpdate || gain != mGain) updateWeightLut(gain);
+    return OK;
+}
+
+/**
+ * The motion threshold follows the noise level, which is about proportional to the square
+ * root of the gain. Below the threshold the pixel is taken as static and gets the max
+ * reference weight, which fades out linearly to 0 at twice the threshold.
+ * The fade out uses a Q8 slope instead of a division, so that the AVX2 path can calculate
+ * the same weights in 16 bits.
+ */
+void IntelCpuTNR::updateWeightLut(int gain) {
+    mGain = gain;
+    // gain is total gain * 100
+    double totalGain = std::max(gain, 100) / 100.0;
+    int threshold = static_cast<int>(CPU_TNR_BASE_THRESHOLD * sqrt(totalGain));
+    threshold = std::min(std::max(threshold, CPU_TNR_BASE_THRESHOLD), CPU_TNR_MAX_THRESHOLD);
+    mThreshold = threshold;
+    mRefWeightSlope = (CPU_TNR_MAX_REF_WEIGHT << 8) / threshold;
+
+    for (int diff = 0; diff < 256; diff++) {
+        int weight = 0;
+        if (diff <= threshold) {
+            weight = CPU_TNR_MAX_REF_WEIGHT;
+        } else if (diff < threshold * 2) {
+            weight = ((threshold * 2 - diff) * mRefWeightSlope) >> 8;
+        }
+        mRefWeightLut[diff] = static_cast<uint8_t>(weight);
+    }
+    LOG2("<%d>@%s gain %d, threshold %d", mCameraId, __func__, gain, threshold);
+}
+
+int IntelCpuTNR::runTnrFrame(const void* inBufAddr, void* outBufAddr, uint32_t inBufSize,
+                             uint32_t outBufSize, Tnr7Param* tnrParam, bool syncUpdate, int fd) {
+    TRACE_LOG_PROCESS("IntelCpuTNR", "runTnrFrame");
+    LOG2("<%d>@%s type %d", mCameraId, __func__, mTnrType);
+    CheckAndLogError(inBufAddr == nullptr || outBufAddr == nullptr || tnrParam == nullptr,
+                     UNKNOWN_ERROR, "@%s, buffer is nullptr", __func__);
+    CheckAndLogError(!mRefBuf, NO_INIT, "@%s, tnr isn't initialized", __func__);
+
+    uint32_t frameSize = mStride * mHeight * 3 / 2;
+    CheckAndLogError(inBufSize < frameSize || outBufSize < frameSize, BAD_VALUE,
+                     "@%s, invalid buffer size in:%u out:%u, required %u", __func__, inBufSize,
+                     outBufSize, frameSize);
+
+    struct timespec beginTime = {};
+    if (Log::isLogTagEnabled(ST_GPU_TNR, CAMERA_DEBUG_LOG_LEVEL2)) {
+        clock_gettime(CLOCK_MONOTONIC, &beginTime);
+    }
+
+    if (!mRefValid || tnrParam->bc.is_first_frame) {
+        // Nothing to blend with, restart the reference from this frame
+        MEMCPY_S(mRefBuf.get(), frameSize, inBufAddr, frameSize);
+        MEMCPY_S(outBufAddr, outBufSize, inBufAddr, frameSize);
+        mRefValid = true;
+    } else {
+        {
+            AutoMutex l(mBandLock);
+            mInBuf = static_cast<const uint8_t*>(inBufAddr);
+            mOutBuf = static_cast<uint8_t*>(outBufAddr);
+            mBandsPending = mBandCount - 1;
+            mBandJobId++;
+            mBandStartSignal.broadcast();
+        }
+
+        blendBand(0);
+
+        ConditionLock lock(mBandLock);
+        while (mBandsPending > 0) {
+            mBandDoneSignal.wait(lock);
+        }
+    }
+
+    if (Log::isLogTagEnabled(ST_GPU_TNR, CAMERA_DEBUG_LOG_LEVEL2)) {
+        struct timespec endTime = {};
+        clock_gettime(CLOCK_MONOTONIC, &endTime);
+        uint64_t timeUsedUs = (endTime.tv_sec - beginTime.tv_sec) * 1000000 +
+                              (endTime.tv_nsec - beginTime.tv_nsec) / 1000;
+        LOG2(ST_GPU_TNR, "%s time:%lu us, %d bands", __func__, timeUsedUs, mBandCount);
+    }
+    return OK;
+}
+
+bool IntelCpuTNR::waitAndRunBand(int band, uint64_t* lastJobId) {
+    {
+        ConditionLock lock(mBandLock);
+        while (!mBandExit && mBandJobId == *lastJobId) {
+            mBandStartSignal.wait(lock);
+        }
+        if (mBandExit) return false;
+        *lastJobId = mBandJobId;
+    }
+
+    blendBand(band);
+
+    AutoMutex l(mBandLock);
+    mBandsPending--;
+    if (mBandsPending == 0) mBandDoneSignal.signal();
+    return true;
+}
+
+void IntelCpuTNR::blendBand(int band) {
+    // Y plane rows
+    int startRow = mHeight * band / mBandCount;
+    int endRow = mHeight * (band + 1) / mBandCount;
+    int offset = startRow * mStride;
+    blendRows(mInBuf + offset, mOutBuf + offset, mRefBuf.get() + offset, mWidth,
+              endRow - startRow);
+
+    // Interleaved UV plane rows, blended per byte as the Y plane
+    int uvHeight = mHeight / 2;
+    startRow = uvHeight * band / mBandCount;
+    endRow = uvHeight * (band + 1) / mBandCount;
+    offset = mStride * mHeight + startRow * mStride;
+    blendRows(mInBuf + offset, mOutBuf + offset, mRefBuf.get() + offset, mWidth,
+              endRow - startRow);
+}
+
+#ifdef CPU_TNR_AVX2
+/**
+ * Blend 32 pixels per loop with the weights of mRefWeightLut, but calculated from the
+ * threshold and the slope since AVX2 has no byte table lookup of 256 entries.
+ * The pixels are widened to 16 bits, where the weights and the blended values fit:
+ * (2 * threshold - diff) * slope < 192 << 8 for diff > threshold, and
+ * cur * (256 - weight) + prev * weight + 128 <= 255 * 256 + 128.
+ * Return the count of the blended pixels, the rest of the row is left to the caller.
+ */
+__attribute__((target("avx2"))) static int blendRowAvx2(const uint8_t* in, uint8_t* out,
+                                                         uint8_t* ref, int width, int threshold,
+                                                         int slope) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i threshold16 = _mm256_set1_epi16(threshold);
+    const __m256i doubleThreshold16 = _mm256_set1_epi16(threshold * 2);
+    const __m256i slope16 = _mm256_set1_epi16(slope);
+    const __m256i maxWeight16 = _mm256_set1_epi16(CPU_TNR_MAX_REF_WEIGHT);
+    const __m256i one16 = _mm256_set1_epi16(256);
+    const __m256i rounding16 = _mm256_set1_epi16(128);
+
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i cur = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x));
+        __m256i prev = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ref + x));
+        __m256i diff = _mm256_or_si256(_mm256_subs_epu8(cur, prev), _mm256_subs_epu8(prev, cur));
+
+        __m256i result[2];
+        for (int half = 0; half < 2; half++) {
+            // unpack and pack work in the same order within each 128 bits lane
+            __m256i cur16 =
+                half ? _mm256_unpackhi_epi8(cur, zero) : _mm256_unpacklo_epi8(cur, zero);
+            __m256i prev16 =
+                half ? _mm256_unpackhi_epi8(prev, zero) : _mm256_unpacklo_epi8(prev, zero);
+            __m256i diff16 =
+                half ? _mm256_unpackhi_epi8(diff, zero) : _mm256_unpacklo_epi8(diff, zero);
+
+            __m256i fade = _mm256_mullo_epi16(_mm256_subs_epu16(doubleThreshold16, diff16),
+                                              slope16);
+            __m256i moving = _mm256_cmpgt_epi16(diff16, threshold16);
+            __m256i weight =
+                _mm256_blendv_epi8(maxWeight16, _mm256_srli_epi16(fade, 8), moving);
+
+            __m256i value = _mm256_add_epi16(
+                _mm256_mullo_epi16(cur16, _mm256_sub_epi16(one16, weight)),
+                _mm256_mullo_epi16(prev16, weight));
+            result[half] = _mm256_srli_epi16(_mm256_add_epi16(value, rounding16), 8);
+        }
+
+        __m256i blended = _mm256_packus_epi16(result[0], result[1]);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), blended);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(ref + x), blended);
+    }
+
+    return x;
+}
+#endif
+
+void IntelCpuTNR::blendRows(const uint8_t* in, uint8_t* out, uint8_t* ref, int width, int rows) {
+    for (int row = 0; row < rows; row++) {
+        const uint8_t* inLine = in + row * mStride;
+        uint8_t* outLine = out + row * mStride;
+        uint8_t* refLine = ref + row * mStride;
+        int x = 0;
+#ifdef CPU_TNR_AVX2
+        if (mUseAvx2) {
+            x = blendRowAvx2(inLine, outLine, refLine, width, mThreshold, mRefWeightSlope);
+        }
+#endif
+        // The scalar path, and the tail of the AVX2 path
+        for (; x < width; x++) {
+            int cur = inLine[x];
+            int prev = refLine[x];
+            int diff = cur > prev ? cur - prev : prev - cur;
+            int weight = mRefWeightLut[diff];
+            uint8_t value = static_cast<uint8_t>((cur * (256 - weight) + prev * weight + 128) >> 8);
+            outLine[x] = value;
+            refLine[x] = value;
+        }
+    }
+}
+
 #ifdef TNR7_CM
 IntelC4mTNR::~IntelC4mTNR() {
     for (auto surface : mCMSurfaceMap) {
@@ -81,6 +399,7 @@ void* IntelC4mTNR::allocCamBuf(uint32_t bufSize, int id) {
 void IntelC4mTNR::freeAllBufs() {
     LOG1("<%d>@%s, type %d", mCameraId, __func__, mTnrType);
     for (auto surface : mCMSurfaceMap) {
+        if (mPreparedBufs.find(surface.first) != mPreparedBufs.end()) continue;
         ::free(surface.first);
     }
     if (mTnrParam) {
@@ -91,13 +410,30 @@ void IntelC4mTNR::freeAllBufs() {
 int IntelC4mTNR::prepareSurface(void* bufAddr, int size) {
     CheckAndLogError(size < mWidth * mHeight * 3 / 2, UNKNOWN_ERROR, "%s, invalid buffer size:%d",
                      __func__, size);
+    // The caller may prepare the same address again with another size
+    auto it = mCMSurfaceMap.find(bufAddr);
+    if (it != mCMSurfaceMap.end()) {
+        destroyCMSurface(it->second);
+        mCMSurfaceMap.erase(it);
+    }
     CmSurface2DUP* surface = createCMSurface(bufAddr);
     CheckAndLogError(!surface, UNKNOWN_ERROR, "Failed to create CMSurface");
     mCMSurfaceMap[bufAddr] = surface;
+    mPreparedBufs.insert(bufAddr);
 
     return OK;
 }
 
+void IntelC4mTNR::releaseSurface(void* bufAddr) {
+    if (mPreparedBufs.erase(bufAddr) == 0) return;
+
+    auto it = mCMSurfaceMap.find(bufAddr);
+    if (it != mCMSurfaceMap.end()) {
+        destroyCMSurface(it->second);
+        mCMSurfaceMap.erase(it);
+    }
+}
+
 int IntelC4mTNR::runTnrFrame(const void* inBufAddr, void* outBufAddr, uint32_t inBufSize,
                              uint32_t outBufSize, Tnr7Param* tnrParam, bool syncUpdate, int fd) {
     TRACE_LOG_PROCESS("IntelC4mTNR", "runTnrFrame");
@@ -16,11 +16,15 @@
 
 #pragma once
 
+#ifdef TNR7_CM
 #include <base/threading/thread.h>
+#endif
 #include <pthread.h>
 
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 extern "C" {
 #include "ia_pal_types_isp_parameters_autogen.h"
 }
@@ -28,6 +32,7 @@ extern "C" {
 #include "CameraBuffer.h"
 #include "PlatformData.h"
 #include "TNRCommon.h"
+#include "iutils/Thread.h"
 
 #ifdef TNR7_CM
 /* the cm_rt.h has some build error with current clang build flags
@@ -59,7 +64,11 @@ namespace icamera {
 
 class IntelTNR7US {
  public:
-    static IntelTNR7US* createIntelTNR(int cameraId);
+    /**
+     * Create the TNR backend, the caller decides on the CPU one since PlatformData isn't
+     * available in the sandboxed algo server
+     */
+    static IntelTNR7US* createIntelTNR(int cameraId, bool useCpuTnr = false);
     virtual ~IntelTNR7US() {}
     virtual int init(int width, int height, TnrType type = TNR_INSTANCE0) = 0;
     /**
@@ -77,6 +86,7 @@ class IntelTNR7US {
     virtual void* allocCamBuf(uint32_t bufSize, int id) = 0;
     virtual void freeAllBufs() = 0;
     virtual int prepareSurface(void* bufAddr, int size) { return OK; }
+    virtual void releaseSurface(void* bufAddr) {}
     virtual int asyncParamUpdate(int gain, bool forceUpdate) { return OK; }
     virtual int getTnrBufferSize(int width, int height, uint32_t* size) { return BAD_VALUE; }
 
@@ -98,6 +108,74 @@ class IntelTNR7US {
     DISALLOW_COPY_AND_ASSIGN(IntelTNR7US);
 };
 
+/**
+ * CPU implementation of the TNR interface, for the platforms without a usable GPU.
+ * It does a motion adaptive blending of the input frame with the last output frame on NV12,
+ * and splits the frame into row bands which are blended in parallel. The rows are blended
+ * with AVX2 when the cpu supports it.
+ */
+class IntelCpuTNR : public IntelTNR7US {
+ public:
+    explicit IntelCpuTNR(int cameraId);
+    virtual ~IntelCpuTNR();
+    virtual int init(int width, int height, TnrType type = TNR_INSTANCE0);
+    virtual int runTnrFrame(const void* inBufAddr, void* outBufAddr, uint32_t inBufSize,
+                            uint32_t outBufSize, Tnr7Param* tnrParam, bool syncUpdate, int fd = -1);
+    virtual void* allocCamBuf(uint32_t bufSize, int id);
+    virtual void freeAllBufs();
+    virtual int asyncParamUpdate(int gain, bool forceUpdate);
+
+ private:
+    class BandThread : public Thread {
+     public:
+        BandThread(IntelCpuTNR* tnr, int band) : mTnr(tnr), mBand(band), mLastJobId(0) {}
+        virtual bool threadLoop() { return mTnr->waitAndRunBand(mBand, &mLastJobId); }
+
+     private:
+        IntelCpuTNR* mTnr;
+        int mBand;
+        uint64_t mLastJobId;
+    };
+
+    bool waitAndRunBand(int band, uint64_t* lastJobId);
+    void blendBand(int band);
+    void blendRows(const uint8_t* in, uint8_t* out, uint8_t* ref, int width, int rows);
+    void updateWeightLut(int gain);
+    void stopBandThreads();
+
+ private:
+    static const int kMaxBandCount = 4;
+
+    int mStride;
+    int mBandCount;
+    std::vector<std::unique_ptr<BandThread>> mBandThreads;
+
+    // Guard the band job below, which is shared with the band threads
+    Mutex mBandLock;
+    Condition mBandStartSignal;
+    Condition mBandDoneSignal;
+    uint64_t mBandJobId;
+    int mBandsPending;
+    bool mBandExit;
+    const uint8_t* mInBuf;
+    uint8_t* mOutBuf;
+
+    // The reference (last output) frame, updated in place when blending
+    std::unique_ptr<uint8_t[]> mRefBuf;
+    bool mRefValid;
+    int mGain;
+    // Weight of the reference in Q8, indexed by the absolute difference of the pixels
+    uint8_t mRefWeightLut[256];
+    // The motion threshold and the Q8 fade out slope of the weight, mRefWeightLut is built
+    // from them, and the AVX2 path calculates the same weights with them
+    int mThreshold;
+    int mRefWeightSlope;
+    bool mUseAvx2;
+    std::vector<void*> mCamBufs;
+
+    DISALLOW_COPY_AND_ASSIGN(IntelCpuTNR);
+};
+
 #ifdef TNR7_CM
 class IntelC4mTNR : public IntelTNR7US {
  public:
@@ -117,6 +195,7 @@ class IntelC4mTNR : public IntelTNR7US {
     virtual void* allocCamBuf(uint32_t bufSize, int id);
     virtual void freeAllBufs();
     virtual int prepareSurface(void* bufAddr, int size);
+    virtual void releaseSurface(void* bufAddr);
     virtual int asyncParamUpdate(int gain, bool forceUpdate);
     virtual int getTnrBufferSize(int width, int height, uint32_t* size);
 
@@ -134,6 +213,8 @@ class IntelC4mTNR : public IntelTNR7US {
  private:
     // Tnr will create CMSurface for input buffers and cache them in the map
     std::unordered_map<void*, CmSurface2DUP*> mCMSurfaceMap;
+    // The buffers owned by the caller, which have surfaces in mCMSurfaceMap but mustn't be freed
+    std::unordered_set<void*> mPreparedBufs;
     std::unique_ptr<base::Thread> mThread;
 };
 #endif
@@ -21,6 +21,9 @@
 #include <GCSSParser.h>
 #include <graph_query_manager.h>
 
+#include <stdint.h>
+#include <stdio.h>
+
 #include <algorithm>
 #include <unordered_map>
 
@@ -42,13 +45,11 @@ namespace icamera {
 
 Mutex GraphConfigImpl::sLock;
 std::unordered_map<int32_t, GraphConfigNodes*> GraphConfigImpl::mGraphNode;
+std::unordered_map<std::string, std::weak_ptr<GCSS::IGraphConfig>> GraphConfigImpl::sGraphFiles;
 
-GraphConfigNodes::GraphConfigNodes() : mDesc(nullptr), mSettings(nullptr) {}
+GraphConfigNodes::GraphConfigNodes() {}
 
-GraphConfigNodes::~GraphConfigNodes() {
-    delete mDesc;
-    delete mSettings;
-}
+GraphConfigNodes::~GraphConfigNodes() {}
 
 GraphConfigImpl::GraphConfigImpl()
         : mCameraId(-1),
@@ -71,8 +72,8 @@ GraphConfigImpl::GraphConfigImpl(int32_t camId, ConfigMode mode, GraphSettingTyp
     CheckAndLogError(!nodes, VOID_VALUE, "Failed to allocate Graph Query Manager");
 
     mGraphQueryManager = std::unique_ptr<GCSS::GraphQueryManager>(new GraphQueryManager());
-    mGraphQueryManager->setGraphDescriptor(nodes->mDesc);
-    mGraphQueryManager->setGraphSettings(nodes->mSettings);
+    mGraphQueryManager->setGraphDescriptor(nodes->mDesc.get());
+    mGraphQueryManager->setGraphSettings(nodes->mSettings.get());
 }
 
 GraphConfigImpl::~GraphConfigImpl() {}
@@ -105,6 +106,59 @@ void GraphConfigImpl::addCustomKeyMap() {
     ItemUID::addCustomKeyMap(CUSTOM_GRAPH_KEYS);
 }
 
+/**
+ * The key of the graph data in sGraphFiles: the FNV-1a digest and the size of the data, so that
+ * the data isn't copied into the key.
+ */
+static string getGraphDataKey(const char* data, size_t dataSize) {
+    uint64_t digest = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < dataSize; i++) {
+        digest ^= static_cast<uint8_t>(data[i]);
+        digest *= 0x100000001b3ULL;
+    }
+
+    char key[64];
+    snprintf(key, sizeof(key), "data:%016llx:%zu", static_cast<unsigned long long>(digest),
+             dataSize);
+    return key;
+}
+
+/**
+ * Parse the XML graph file, or the graph data if data isn't nullptr.
+ *
+ * The graph descriptor is the same for all cameras, and the cameras with the same sensor use
+ * the same settings, so the parsed graphs are shared instead of parsing the same file again.
+ * Called with sLock held.
+ */
+shared_ptr<GCSS::IGraphConfig> GraphConfigImpl::parseGraph(const char* fileName, char* data,
+                                                           size_t dataSize) {
+    string key = data ? getGraphDataKey(data, dataSize) : "file:" + string(fileName);
+    auto it = sGraphFiles.find(key);
+    if (it != sGraphFiles.end()) {
+        shared_ptr<GCSS::IGraphConfig> graph = it->second.lock();
+        if (graph) {
+            LOG2("%s: %s has been parsed", __func__, data ? "graph data" : fileName);
+            return graph;
+        }
+    }
+
+    nsecs_t startTime = CameraUtils::systemTime();
+    GCSSParser parser;
+    GCSS::IGraphConfig* graph = nullptr;
+    if (data) {
+        parser.parseGCSSXmlData(data, dataSize, &graph);
+    } else {
+        parser.parseGCSSXmlFile(fileName, &graph);
+    }
+    if (!graph) return nullptr;
+
+    LOG1("%s: parse %s takes %ld ms", __func__, data ? "graph data" : fileName,
+         (CameraUtils::systemTime() - startTime) / 1000000);
+    shared_ptr<GCSS::IGraphConfig> sharedGraph(graph);
+    sGraphFiles[key] = sharedGraph;
+    return sharedGraph;
+}
+
 /**
  * Method to parse the XML graph configurations and settings
  *
@@ -118,34 +172,30 @@ void GraphConfigImpl::addCustomKeyMap() {
 status_t GraphConfigImpl::parse(int cameraId, const char* graphDescFile, const char* settingsFile) {
     HAL_TRACE_CALL(CAMERA_DEBUG_LOG_LEVEL1);
 
-    {
-        AutoMutex lock(sLock);
-        auto it = mGraphNode.find(cameraId);
-        if (it != mGraphNode.end()) {
-            LOG2("<id%d>, The graph config has been parsed", cameraId);
-            return OK;
-        }
+    AutoMutex lock(sLock);
+    auto it = mGraphNode.find(cameraId);
+    if (it != mGraphNode.end()) {
+        LOG2("<id%d>, The graph config has been parsed", cameraId);
+        return OK;
     }
 
-    GCSSParser parser;
     GraphConfigNodes* nodes = new GraphConfigNodes;
     LOG2("<id%d>, Start to parse graph config file", cameraId);
 
-    parser.parseGCSSXmlFile(graphDescFile, &nodes->mDesc);
+    nodes->mDesc = parseGraph(graphDescFile, nullptr, 0);
     if (!nodes->mDesc) {
         LOGE("Failed to parse graph descriptor from %s", graphDescFile);
         delete nodes;
         return UNKNOWN_ERROR;
     }
 
-    parser.parseGCSSXmlFile(settingsFile, &nodes->mSettings);
+    nodes->mSettings = parseGraph(settingsFile, nullptr, 0);
     if (!nodes->mSettings) {
         LOGE("Failed to parse graph settings from %s", settingsFile);
         delete nodes;
         return UNKNOWN_ERROR;
     }
 
-    AutoMutex lock(sLock);
     mGraphNode[cameraId] = nodes;
 
     return OK;
@@ -167,34 +217,30 @@ status_t GraphConfigImpl::parse(int cameraId, char* graphDescData, size_t descDa
                                 char* settingsData, size_t settingsDataSize) {
     HAL_TRACE_CALL(CAMERA_DEBUG_LOG_LEVEL1);
 
-    {
-        AutoMutex lock(sLock);
-        auto it = mGraphNode.find(cameraId);
-        if (it != mGraphNode.end()) {
-            LOG2("<id%d>, the graph config has been parsed", cameraId);
-            return OK;
-        }
+    AutoMutex lock(sLock);
+    auto it = mGraphNode.find(cameraId);
+    if (it != mGraphNode.end()) {
+        LOG2("<id%d>, the graph config has been parsed", cameraId);
+        return OK;
     }
 
-    GCSSParser parser;
     GraphConfigNodes* nodes = new GraphConfigNodes;
     LOG2("<id%d>, Start to parse graph config data", cameraId);
 
-    parser.parseGCSSXmlData(graphDescData, descDataSize, &nodes->mDesc);
+    nodes->mDesc = parseGraph(nullptr, graphDescData, descDataSize);
     if (!nodes->mDesc) {
         LOGE("Failed to parse graph descriptor addr: %p, size: %zu", graphDescData, descDataSize);
         delete nodes;
         return UNKNOWN_ERROR;
     }
 
-    parser.parseGCSSXmlData(settingsData, settingsDataSize, &nodes->mSettings);
+    nodes->mSettings = parseGraph(nullptr, settingsData, settingsDataSize);
     if (!nodes->mSettings) {
         LOGE("Failed to parse graph settings addr: %p, size: %zu", settingsData, settingsDataSize);
         delete nodes;
         return UNKNOWN_ERROR;
     }
 
-    AutoMutex lock(sLock);
     mGraphNode[cameraId] = nodes;
 
     return OK;
@@ -210,6 +256,7 @@ void GraphConfigImpl::releaseGraphNodes() {
         delete nodes.second;
     }
     mGraphNode.clear();
+    sGraphFiles.clear();
 }
 
 /**
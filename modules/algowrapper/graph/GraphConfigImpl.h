@@ -50,6 +50,7 @@ enum AndroidGraphConfigKey {
 
 /**
  * Static data for graph settings for given sensor. Used to initialize GraphConfigImpl.
+ * The nodes are read only after parsing, and shared by the cameras using the same graph files.
  */
 class GraphConfigNodes {
  public:
@@ -57,8 +58,8 @@ class GraphConfigNodes {
     ~GraphConfigNodes();
 
  public:
-    GCSS::IGraphConfig* mDesc;
-    GCSS::IGraphConfig* mSettings;
+    std::shared_ptr<GCSS::IGraphConfig> mDesc;
+    std::shared_ptr<GCSS::IGraphConfig> mSettings;
 
  private:
     // Disable copy constructor and assignment operator
@@ -138,9 +139,14 @@ class GraphConfigImpl {
     // Debug helper
     void dumpQuery(int useCase, const std::map<GCSS::ItemUID, std::string>& query);
 
+    static std::shared_ptr<GCSS::IGraphConfig> parseGraph(const char* fileName, char* data,
+                                                          size_t dataSize);
+
  private:
-    static Mutex sLock;
+    static Mutex sLock;  // Also serializes the parsing, the GCSS parser isn't thread safe
     static std::unordered_map<int32_t, GraphConfigNodes*> mGraphNode;
+    // The parsed graphs, key: "file:" + file name or "data:" + digest and size of graph data
+    static std::unordered_map<std::string, std::weak_ptr<GCSS::IGraphConfig>> sGraphFiles;
     /**
      * Pair of ItemUIDs to store the width and height of a stream
      * first item is for width, second for height
@@ -25,11 +25,14 @@
 #include "iutils/Utils.h"
 namespace icamera {
 
-IntelTNR7US* IntelTNR7US::createIntelTNR(int cameraId) {
-    if (!PlatformData::isGpuTnrEnabled()) return nullptr;
+IntelTNR7US* IntelTNR7US::createIntelTNR(int cameraId, bool useCpuTnr) {
+    if (!PlatformData::isGpuTnrEnabled(cameraId)) return nullptr;
 #ifdef TNR7_CM
-    return new IntelC4mTNR(cameraId);
+    // The server creates the CPU or GPU backend with the flag in the init info
+    return new IntelC4mTNR(cameraId, useCpuTnr);
 #else
+    // The CPU backend is only served with the TNR IPC of the TNR7_CM build
+    if (useCpuTnr) LOGW("<id%d> %s, CPU TNR isn't supported, use the GPU TNR", cameraId, __func__);
     return new IntelLevel0TNR(cameraId);
 #endif
 }
@@ -71,11 +74,12 @@ void IntelTNR7US::freeAllBufs() {
 }
 
 #ifdef TNR7_CM
-IntelC4mTNR::IntelC4mTNR(int cameraId)
+IntelC4mTNR::IntelC4mTNR(int cameraId, bool useCpuTnr)
         : IntelTNR7US(cameraId),
           mTnrType(TNR_INSTANCE_MAX),
+          mUseCpuTnr(useCpuTnr),
           mTnrRequestInfo(nullptr) {
-    LOG1("<id%d> %s, Construct", cameraId, __func__);
+    LOG1("<id%d> %s, Construct, cpu tnr %d", cameraId, __func__, useCpuTnr);
 }
 
 IntelC4mTNR::~IntelC4mTNR() {
@@ -115,7 +119,7 @@ int IntelC4mTNR::init(int width, int height, TnrType type) {
     }
 
     TnrInitInfo* initInfo = static_cast<TnrInitInfo*>(initInfoMems.mAddr);
-    *initInfo = {width, height, mCameraId, type};
+    *initInfo = {width, height, mCameraId, type, mUseCpuTnr};
 
     ret = mCommon.requestSync(IPC_GPU_TNR_INIT, initInfoMems.mHandle);
     if (!ret) {
@@ -124,7 +128,8 @@ int IntelC4mTNR::init(int width, int height, TnrType type) {
     }
     mCommon.freeShmMem(initInfoMems, GPU_ALGO_SHM);
     mTnrType = type;
-    LOG1("%s, GPU TNR instance size %dx%d, type %d", __func__, width, height, mTnrType);
+    LOG1("%s, %s TNR instance size %dx%d, type %d", __func__, mUseCpuTnr ? "CPU" : "GPU", width,
+         height, mTnrType);
 
     return ret ? OK : UNKNOWN_ERROR;
 }
@@ -31,7 +31,7 @@
 namespace icamera {
 class IntelTNR7US {
  public:
-    static IntelTNR7US* createIntelTNR(int cameraId);
+    static IntelTNR7US* createIntelTNR(int cameraId, bool useCpuTnr = false);
     virtual ~IntelTNR7US(){};
     virtual int init(int width, int height, TnrType type = TNR_INSTANCE0) = 0;
     /**
@@ -49,6 +49,7 @@ class IntelTNR7US {
     virtual void* allocCamBuf(uint32_t bufSize, int id);
     virtual void freeAllBufs();
     int prepareSurface(void* bufAddr, int size) { return OK; }
+    void releaseSurface(void* bufAddr) {}
     virtual int asyncParamUpdate(int gain, bool forceUpdate) { return OK; }
     virtual int getTnrBufferSize(int width, int height, uint32_t* size) { return BAD_VALUE; }
 
@@ -63,7 +64,7 @@ class IntelTNR7US {
 #ifdef TNR7_CM
 class IntelC4mTNR : public IntelTNR7US {
  public:
-    explicit IntelC4mTNR(int cameraId);
+    IntelC4mTNR(int cameraId, bool useCpuTnr);
     virtual ~IntelC4mTNR();
     virtual int init(int width, int height, TnrType type = TNR_INSTANCE0);
     virtual int runTnrFrame(const void* inBufAddr, void* outBufAddr, uint32_t inBufSize,
@@ -75,6 +76,8 @@ class IntelC4mTNR : public IntelTNR7US {
 
  private:
     TnrType mTnrType;
+    // Ask the server for the CPU backend
+    bool mUseCpuTnr;
     TnrRequestInfo* mTnrRequestInfo;
     ShmMemInfo mTnrRequestInfoMem;
     DISALLOW_COPY_AND_ASSIGN(IntelC4mTNR);
@@ -63,8 +63,8 @@ int IntelTNRServer::init(void* pData, int dataSize) {
 
     int key = getIndex(initInfo->cameraId, initInfo->type);
     if (mIntelTNRMap.find(key) == mIntelTNRMap.end()) {
-        mIntelTNRMap[key] =
-            std::unique_ptr<IntelTNR7US>(IntelTNR7US::createIntelTNR(initInfo->cameraId));
+        mIntelTNRMap[key] = std::unique_ptr<IntelTNR7US>(
+            IntelTNR7US::createIntelTNR(initInfo->cameraId, initInfo->useCpuTnr));
     }
 
     mLockMap[key] = std::unique_ptr<std::mutex>(new std::mutex);
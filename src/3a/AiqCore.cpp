@@ -23,6 +23,7 @@
 #include <algorithm>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "AiqUtils.h"
 #include "Parameters.h"
@@ -70,11 +71,6 @@ AiqCore::AiqCore(int cameraId)
     CLEAR(mSaParams);
     CLEAR(mPaColorGains);
 
-    CLEAR(mResizeLscGridR);
-    CLEAR(mResizeLscGridGr);
-    CLEAR(mResizeLscGridGb);
-    CLEAR(mResizeLscGridB);
-
     CLEAR(mLensShadingMapSize);
     CLEAR(mLscGridRGGB);
 
@@ -647,42 +643,25 @@ int AiqCore::reFormatLensShadingMap(const LSCGrid& inputLscGrid, float* dstLscGr
     return OK;
 }
 
-int AiqCore::storeLensShadingMap(const LSCGrid& inputLscGrid, const LSCGrid& resizeLscGrid,
+int AiqCore::storeLensShadingMap(const LSCGrid& inputLscGrid, int destWidth, int destHeight,
                                  float* dstLscGridRGGB) {
-    CheckAndLogError(inputLscGrid.isBad() || resizeLscGrid.isBad() || !dstLscGridRGGB, BAD_VALUE,
-                     "@%s, Bad input values for lens shading map storing", __func__);
-
-    int destWidth = resizeLscGrid.width;
-    int destHeight = resizeLscGrid.height;
-    int width = inputLscGrid.width;
-    int height = inputLscGrid.height;
-
-    if (width != destWidth || height != destHeight) {
-        // requests lensShadingMapSize must be smaller than 64*64
-        // and it is a constant size.
-        // Our lensShadingMapSize is dynamic based on the resolution, so need
-        // to do resize for 4 channels separately
-
-        AiqUtils::resize2dArray(inputLscGrid.gridR, width, height, resizeLscGrid.gridR, destWidth,
-                                destHeight);
-        AiqUtils::resize2dArray(inputLscGrid.gridGr, width, height, resizeLscGrid.gridGr, destWidth,
-                                destHeight);
-        AiqUtils::resize2dArray(inputLscGrid.gridGb, width, height, resizeLscGrid.gridGb, destWidth,
-                                destHeight);
-        AiqUtils::resize2dArray(inputLscGrid.gridB, width, height, resizeLscGrid.gridB, destWidth,
-                                destHeight);
-
-        LOG2("%s:resize lens shading map from [%d,%d] to [%d,%d]", __func__, width, height,
-             destWidth, destHeight);
-    } else {
-        size_t size = destWidth * destHeight * sizeof(resizeLscGrid.gridR[0]);
-        STDCOPY((int8_t*)resizeLscGrid.gridR, (int8_t*)inputLscGrid.gridR, size);
-        STDCOPY((int8_t*)resizeLscGrid.gridGr, (int8_t*)inputLscGrid.gridGr, size);
-        STDCOPY((int8_t*)resizeLscGrid.gridGb, (int8_t*)inputLscGrid.gridGb, size);
-        STDCOPY((int8_t*)resizeLscGrid.gridB, (int8_t*)inputLscGrid.gridB, size);
+    CheckAndLogError(inputLscGrid.isBad() || destWidth <= 0 || destHeight <= 0 || !dstLscGridRGGB,
+                     BAD_VALUE, "@%s, Bad input values for lens shading map storing", __func__);
+
+    // requests lensShadingMapSize must be smaller than 64*64 and it is a constant size.
+    // Our lensShadingMapSize is dynamic based on the resolution, so need to do resize.
+    if (inputLscGrid.width == destWidth && inputLscGrid.height == destHeight) {
+        return reFormatLensShadingMap(inputLscGrid, dstLscGridRGGB);
     }
 
-    return reFormatLensShadingMap(resizeLscGrid, dstLscGridRGGB);
+    // Metadata spec request order [R, Geven, Godd, B]
+    const uint16_t* channels[] = {inputLscGrid.gridR, inputLscGrid.gridGr, inputLscGrid.gridGb,
+                                  inputLscGrid.gridB};
+    int ret = AiqUtils::resizeLscGridRGGB(channels, inputLscGrid.width, inputLscGrid.height,
+                                          dstLscGridRGGB, destWidth, destHeight);
+    CheckAndLogError(ret != OK, BAD_VALUE, "@%s, Bad lens shading map size [%d,%d] to [%d,%d]",
+                     __func__, inputLscGrid.width, inputLscGrid.height, destWidth, destHeight);
+    return OK;
 }
 
 int AiqCore::processSAResults(cca::cca_sa_results* saResults, float* lensShadingMap) {
@@ -706,18 +685,10 @@ int AiqCore::processSAResults(cca::cca_sa_results* saResults, float* lensShading
         inputGrid.width = saResults->width;
         inputGrid.height = saResults->height;
 
-        LSCGrid resizeGrid;
-        resizeGrid.gridB = mResizeLscGridB;
-        resizeGrid.gridR = mResizeLscGridR;
-        resizeGrid.gridGr = mResizeLscGridGr;
-        resizeGrid.gridGb = mResizeLscGridGb;
-        resizeGrid.width = mLensShadingMapSize.x;
-        resizeGrid.height = mLensShadingMapSize.y;
-
-        storeLensShadingMap(inputGrid, resizeGrid, mLscGridRGGB);
+        storeLensShadingMap(inputGrid, mLensShadingMapSize.x, mLensShadingMapSize.y,
+                            mLscGridRGGB);
 
-        // resizeGrid's width and height should be equal to inputGrid's width and height
-        mLscGridRGGBLen = resizeGrid.width * resizeGrid.height * 4;
+        mLscGridRGGBLen = mLensShadingMapSize.x * mLensShadingMapSize.y * 4;
         size_t errCount = 0;
         for (size_t i = 0; i < mLscGridRGGBLen; i++) {
             if (mLscGridRGGB[i] < 1.0f) {
@@ -143,7 +143,7 @@ class AiqCore {
                              camera_range_t* focusRange);
     int processSAResults(cca::cca_sa_results* saResults, float* lensShadingMap);
     int checkColorOrder(cmc_bayer_order bayerOrder, ColorOrder* colorOrder);
-    int storeLensShadingMap(const LSCGrid& inputLscGrid, const LSCGrid& resizeLscGrid,
+    int storeLensShadingMap(const LSCGrid& inputLscGrid, int destWidth, int destHeight,
                             float* dstLscGridRGGB);
     int reFormatLensShadingMap(const LSCGrid& inputLscGrid, float* dstLscGridRGGB);
 
@@ -205,10 +205,6 @@ class AiqCore {
     camera_shading_mode_t mShadingMode;
     camera_lens_shading_map_mode_type_t mLensShadingMapMode;
     camera_coordinate_t mLensShadingMapSize;
-    uint16_t mResizeLscGridR[DEFAULT_LSC_GRID_SIZE];
-    uint16_t mResizeLscGridGr[DEFAULT_LSC_GRID_SIZE];
-    uint16_t mResizeLscGridGb[DEFAULT_LSC_GRID_SIZE];
-    uint16_t mResizeLscGridB[DEFAULT_LSC_GRID_SIZE];
     float mLscOffGrid[DEFAULT_LSC_GRID_SIZE * 4];
     float mLscGridRGGB[DEFAULT_LSC_GRID_SIZE * 4];
     size_t mLscGridRGGBLen;
@@ -21,25 +21,38 @@
 
 namespace icamera {
 
-std::map<int, AiqResultStorage*> AiqResultStorage::sInstances;
+std::atomic<AiqResultStorage*> AiqResultStorage::sInstances[MAX_CAMERA_NUMBER];
 Mutex AiqResultStorage::sLock;
 
 AiqResultStorage* AiqResultStorage::getInstance(int cameraId) {
+    CheckAndLogError(cameraId < 0 || cameraId >= MAX_CAMERA_NUMBER, nullptr,
+                     "@%s, invalid camera id %d", __func__, cameraId);
+
+    AiqResultStorage* storage = sInstances[cameraId].load(std::memory_order_acquire);
+    if (storage) return storage;
+
     AutoMutex lock(sLock);
     return getInstanceLocked(cameraId);
 }
 
 void AiqResultStorage::releaseAiqResultStorage(int cameraId) {
+    CheckAndLogError(cameraId < 0 || cameraId >= MAX_CAMERA_NUMBER, VOID_VALUE,
+                     "@%s, invalid camera id %d", __func__, cameraId);
+
     AutoMutex lock(sLock);
-    AiqResultStorage* storage = getInstanceLocked(cameraId);
-    sInstances.erase(cameraId);
+    AiqResultStorage* storage = sInstances[cameraId].exchange(nullptr, std::memory_order_acq_rel);
     delete storage;
 }
 
-AiqResultStorage::AiqResultStorage(int cameraId) : mCameraId(cameraId) {
+AiqResultStorage::AiqResultStorage(int cameraId) : mCameraId(cameraId), mCurrentIndex(-1) {
     for (int i = 0; i < kStorageSize; i++) {
         mAiqResults[i] = new AiqResult(mCameraId);
         mAiqResults[i]->init();
+        mResultSequences[i].store(-1, std::memory_order_relaxed);
+    }
+
+    for (int i = 0; i < kDvsRunMapSize; i++) {
+        mDvsRunSequences[i].store(-1, std::memory_order_relaxed);
     }
 }
 
@@ -98,37 +111,53 @@ void AiqResultStorage::unLockAiqStatistics() {
 }
 
 AiqResult* AiqResultStorage::acquireAiqResult() {
-    AutoWMutex rlock(mDataLock);
+    AutoMutex lock(mResultLock);
 
-    int index = mCurrentIndex + 1;
+    int index = mCurrentIndex.load(std::memory_order_relaxed) + 1;
     index %= kStorageSize;
+    // Unpublish the slot before the writer starts to fill it
+    mResultSequences[index].store(-1, std::memory_order_release);
     mAiqResults[index]->mSequence = -1;
 
     return mAiqResults[index];
 }
 
 void AiqResultStorage::updateAiqResult(int64_t sequence) {
-    AutoWMutex wlock(mDataLock);
+    AutoMutex lock(mResultLock);
 
-    mCurrentIndex++;
-    mCurrentIndex %= kStorageSize;
-    mAiqResults[mCurrentIndex]->mSequence = sequence;
+    int index = (mCurrentIndex.load(std::memory_order_relaxed) + 1) % kStorageSize;
+    mAiqResults[index]->mSequence = sequence;
+    mResultSequences[index].store(sequence, std::memory_order_release);
+    mCurrentIndex.store(index, std::memory_order_release);
 }
 
 const AiqResult* AiqResultStorage::getAiqResult(int64_t sequence) {
-    AutoRMutex rlock(mDataLock);
+    int currentIndex = mCurrentIndex.load(std::memory_order_acquire);
 
     // Sequence id is -1 means user wants get the latest result.
     if (sequence == -1) {
         // If mCurrentIndex is -1, that means no result is saved to the storage yet,
         // just return the first one in this case.
-        return mAiqResults[(mCurrentIndex == -1) ? 0 : mCurrentIndex];
+        return mAiqResults[(currentIndex == -1) ? 0 : currentIndex];
+    }
+    if (currentIndex == -1) return nullptr;
+
+    // Results are stored for consecutive sequences normally, try the slot directly first.
+    int64_t latest = mResultSequences[currentIndex].load(std::memory_order_acquire);
+    if (latest >= 0 && sequence >= latest) return mAiqResults[currentIndex];
+    int64_t distance = latest - sequence;
+    if (latest >= 0 && distance < kStorageSize) {
+        int tmpIdx = (currentIndex + kStorageSize - static_cast<int>(distance)) % kStorageSize;
+        if (mResultSequences[tmpIdx].load(std::memory_order_acquire) == sequence) {
+            return mAiqResults[tmpIdx];
+        }
     }
 
     for (int i = 0; i < kStorageSize; i++) {
         // Search from the newest result
-        int tmpIdx = (mCurrentIndex + kStorageSize - i) % kStorageSize;
-        if (mAiqResults[tmpIdx]->mSequence >= 0 && sequence >= mAiqResults[tmpIdx]->mSequence) {
+        int tmpIdx = (currentIndex + kStorageSize - i) % kStorageSize;
+        int64_t tmpSeq = mResultSequences[tmpIdx].load(std::memory_order_acquire);
+        if (tmpSeq >= 0 && sequence >= tmpSeq) {
             return mAiqResults[tmpIdx];
         }
     }
@@ -137,41 +166,35 @@ const AiqResult* AiqResultStorage::getAiqResult(int64_t sequence) {
 }
 
 void AiqResultStorage::updateDvsRunMap(int64_t sequence) {
-    AutoWMutex wlock(mDataLock);
-
-    mDvsRunMap[sequence] = true;
+    if (sequence < 0) return;
 
-    if (mDvsRunMap.size() > kDvsRunMapSize) {
-        mDvsRunMap.erase(mDvsRunMap.begin());
-    }
+    mDvsRunSequences[sequence % kDvsRunMapSize].store(sequence, std::memory_order_release);
 }
 
 void AiqResultStorage::clearDvsRunMap() {
-    AutoWMutex wlock(mDataLock);
-
-    mDvsRunMap.clear();
+    for (int i = 0; i < kDvsRunMapSize; i++) {
+        mDvsRunSequences[i].store(-1, std::memory_order_release);
+    }
 }
 
 bool AiqResultStorage::isDvsRun(int64_t sequence) {
-    AutoWMutex rlock(mDataLock);
-
-    if (mDvsRunMap.find(sequence) != mDvsRunMap.end()) {
-        return true;
-    }
+    if (sequence < 0) return false;
 
-    return false;
+    return mDvsRunSequences[sequence % kDvsRunMapSize].load(std::memory_order_acquire) ==
+           sequence;
 }
 
 /**
  * Private function with no lock in it, must be called with lock protection
  */
 AiqResultStorage* AiqResultStorage::getInstanceLocked(int cameraId) {
-    if (sInstances.find(cameraId) != sInstances.end()) {
-        return sInstances[cameraId];
+    AiqResultStorage* storage = sInstances[cameraId].load(std::memory_order_relaxed);
+    if (!storage) {
+        storage = new AiqResultStorage(cameraId);
+        sInstances[cameraId].store(storage, std::memory_order_release);
     }
 
-    sInstances[cameraId] = new AiqResultStorage(cameraId);
-    return sInstances[cameraId];
+    return storage;
 }
 
 }  // namespace icamera
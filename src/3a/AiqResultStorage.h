@@ -16,7 +16,7 @@
 
 #pragma once
 
-#include <map>
+#include <atomic>
 
 #include "AiqResult.h"
 
@@ -41,6 +41,10 @@ namespace icamera {
  *
  * It's a singleton based on camera id, and its life cycle can be maintained by
  * its static methods getInstance and releaseAiqResultStorage.
+ *
+ * The AiqResult readers never take a lock: every slot publishes its sequence id
+ * atomically after the writer filled it, and a sequence id is mapped to its slot
+ * directly when the results are stored for consecutive sequences.
  */
 class AiqResultStorage {
  public:
@@ -137,24 +141,28 @@ class AiqResultStorage {
     static AiqResultStorage* getInstanceLocked(int cameraId);
 
  private:
-    static std::map<int, AiqResultStorage*> sInstances;
+    // The instances are indexed by camera id, so that getInstance is a plain load.
+    static std::atomic<AiqResultStorage*> sInstances[MAX_CAMERA_NUMBER];
     // Guard for singleton creation.
     static Mutex sLock;
 
     int mCameraId;
-    RWLock mDataLock;  // lock for all the data storage below
+    Mutex mResultLock;  // Serializes the AiqResult writers, readers are lock free
+    RWLock mDataLock;   // lock for the AIQ statistics storage
 
     static const int kStorageSize = MAX_SETTING_COUNT;  // Should > MAX_BUFFER_COUNT + sensorLag
-    int mCurrentIndex = -1;
+    std::atomic<int> mCurrentIndex;
     AiqResult* mAiqResults[kStorageSize];
+    // The published sequence id of each slot in mAiqResults, -1 while it's being filled
+    std::atomic<int64_t> mResultSequences[kStorageSize];
 
     static const int kAiqStatsStorageSize = 3;  // Always use the latest, but may hold for long time
     int mCurrentAiqStatsIndex = -1;
     AiqStatistics mAiqStatistics[kAiqStatsStorageSize];
 
     static const int kDvsRunMapSize = 15;
-    // first: sequence id, second: true
-    std::map<int64_t, bool> mDvsRunMap;
+    // The sequence id which dvs runs for, indexed by (sequence % kDvsRunMapSize)
+    std::atomic<int64_t> mDvsRunSequences[kDvsRunMapSize];
 };
 
 }  // namespace icamera
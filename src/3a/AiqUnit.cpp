@@ -38,7 +38,8 @@ AiqUnit::AiqUnit(int cameraId, SensorHwCtrl* sensorHw, LensHw* lensHw)
           mDvs(nullptr),
           // INTEL_DVS_S
           mCcaInitialized(false),
-          mActiveStreamCount(0) {
+          mActiveStreamCount(0),
+          mLastAiqdSnapshotTime(0) {
     mAiqSetting = new AiqSetting(cameraId);
     mAiqEngine = new AiqEngine(cameraId, sensorHw, lensHw, mAiqSetting);
 
@@ -404,14 +405,7 @@ void AiqUnit::deinitIntelCcaHandle() {
                          __func__, mode, mCameraId);
 
         if (PlatformData::isAiqdEnabled(mCameraId)) {
-            cca::cca_aiqd aiqd = {};
-            ia_err iaErr = intelCca->getAiqd(&aiqd);
-            if (AiqUtils::convertError(iaErr) == OK) {
-                ia_binary_data data = {aiqd.buf, static_cast<unsigned int>(aiqd.size)};
-                PlatformData::saveAiqd(mCameraId, mode, data);
-            } else {
-                LOGW("@%s, failed to get aiqd data, iaErr %d", __func__, iaErr);
-            }
+            saveAiqd(intelCca, mode);
         }
 
         int ret = PlatformData::deinitMakernote(mCameraId, mode);
@@ -426,6 +420,32 @@ void AiqUnit::deinitIntelCcaHandle() {
     mCcaInitialized = false;
 }
 
+void AiqUnit::saveAiqd(IntelCca* intelCca, TuningMode mode) {
+    cca::cca_aiqd aiqd = {};
+    ia_err iaErr = intelCca->getAiqd(&aiqd);
+    if (AiqUtils::convertError(iaErr) == OK) {
+        ia_binary_data data = {aiqd.buf, static_cast<unsigned int>(aiqd.size)};
+        // The data is written to file asynchronously
+        PlatformData::saveAiqd(mCameraId, mode, data);
+    } else {
+        LOGW("@%s, failed to get aiqd data, iaErr %d", __func__, iaErr);
+    }
+}
+
+void AiqUnit::saveAiqdSnapshot() {
+    if (!mCcaInitialized || !PlatformData::isAiqdEnabled(mCameraId)) return;
+
+    nsecs_t now = CameraUtils::systemTime();
+    if (now - mLastAiqdSnapshotTime < kAiqdSnapshotInterval) return;
+    mLastAiqdSnapshotTime = now;
+
+    LOG2("<id%d>@%s", mCameraId, __func__);
+    for (auto& mode : mTuningModes) {
+        IntelCca* intelCca = IntelCca::getInstance(mCameraId, mode);
+        if (intelCca) saveAiqd(intelCca, mode);
+    }
+}
+
 int AiqUnit::start() {
     AutoMutex l(mAiqUnitLock);
     LOG1("<id%d>@%s", mCameraId, __func__);
@@ -443,6 +463,7 @@ int AiqUnit::start() {
     int ret = mAiqEngine->startEngine();
     if (ret == OK) {
         mAiqUnitState = AIQ_UNIT_START;
+        mLastAiqdSnapshotTime = CameraUtils::systemTime();
     }
 
     return OK;
@@ -478,6 +499,8 @@ int AiqUnit::run3A(long requestId, int64_t applyingSeq, int64_t* effectSeq) {
     int ret = mAiqEngine->run3A(requestId, applyingSeq, effectSeq);
     CheckAndLogError(ret != OK, ret, "run 3A failed.");
 
+    saveAiqdSnapshot();
+
     return OK;
 }
 
@@ -161,6 +161,8 @@ class AiqUnit : public AiqUnitBase {
     void resetIntelCcaHandle(const std::vector<ConfigMode>& configModes);
     int initIntelCcaHandle(const std::vector<ConfigMode>& configModes);
     void deinitIntelCcaHandle();
+    void saveAiqd(IntelCca* intelCca, TuningMode mode);
+    void saveAiqdSnapshot();
     void dumpCcaInitParam(const cca::cca_init_params params);
 
  private:
@@ -189,6 +191,10 @@ class AiqUnit : public AiqUnitBase {
     std::vector<TuningMode> mTuningModes;
     bool mCcaInitialized;
     size_t mActiveStreamCount;
+
+    // The aiqd is saved periodically when streaming, in case the HAL isn't closed normally
+    static const nsecs_t kAiqdSnapshotInterval = 30000000000LL;  // 30s
+    nsecs_t mLastAiqdSnapshotTime;
 };
 
 } /* namespace icamera */
@@ -18,10 +18,14 @@
 
 #include <math.h>
 #include <algorithm>
+#include <map>
+#include <tuple>
+#include <vector>
 
 #include "iutils/Utils.h"
 #include "iutils/Errors.h"
 #include "iutils/CameraLog.h"
+#include "iutils/Thread.h"
 #include "AiqUtils.h"
 #include "AiqSetting.h"
 
@@ -310,61 +314,129 @@ ia_aiq_frame_use AiqUtils::convertFrameUsageToIaFrameUsage(int frameUsage) {
     return ia_aiq_frame_use_preview;
 }
 
-void AiqUtils::applyTonemapGamma(float gamma, cca::cca_gbce_params* results) {
-    CheckAndLogError(gamma < EPSILON, VOID_VALUE, "Bad gamma %f", gamma);
-    CheckAndLogError(!results, VOID_VALUE, "gbce results nullptr");
+enum TonemapLutType { TONEMAP_LUT_GAMMA = 0, TONEMAP_LUT_SRGB, TONEMAP_LUT_REC709 };
+
+// The LUTs of the manual tonemap curves, which only change with the curve type, gamma and size
+static const size_t kMaxTonemapLutCount = 8;
+static Mutex sTonemapLutLock;
+static std::map<std::tuple<int, float, int>, std::vector<float>> sTonemapLuts;
+
+// The gamma curve is sampled in [0, 1), the sRGB and REC709 curves in [0, 1]
+static float getTonemapValue(int type, float gamma, int index, int lutSize) {
+    float in = index / static_cast<float>(type == TONEMAP_LUT_GAMMA ? lutSize : lutSize - 1);
+    switch (type) {
+        case TONEMAP_LUT_SRGB:
+            return in < 0.0031308 ? 12.92 * in : 1.055 * pow(in, 1 / 2.4) - 0.055;
+        case TONEMAP_LUT_REC709:
+            return in < 0.018 ? 4.5 * in : 1.099 * pow(in, 0.45) - 0.099;
+        default:
+            return pow(in, 1 / gamma);
+    }
+}
 
+/**
+ * Fill the r/g/b LUTs of the results with the tonemap curve, the LUT is generated only
+ * at the first use of the curve and copied from the cache after that.
+ */
+static void applyTonemapLut(int type, float gamma, cca::cca_gbce_params* results) {
     int lutSize = results->gamma_lut_size;
     CheckAndLogError(lutSize < MIN_TONEMAP_POINTS, VOID_VALUE,
                      "Bad gamma lut size (%d) in gbce results", lutSize);
-    for (int i = 0; i < lutSize; i++) {
-        results->g_gamma_lut[i] = pow(i / static_cast<float>(lutSize), 1 / gamma);
+
+    AutoMutex l(sTonemapLutLock);
+    std::tuple<int, float, int> key(type, type == TONEMAP_LUT_GAMMA ? gamma : 0, lutSize);
+    auto lut = sTonemapLuts.find(key);
+    if (lut == sTonemapLuts.end()) {
+        if (sTonemapLuts.size() >= kMaxTonemapLutCount) sTonemapLuts.clear();
+
+        std::vector<float> values(lutSize);
+        for (int i = 0; i < lutSize; i++) {
+            values[i] = getTonemapValue(type, gamma, i, lutSize);
+        }
+        lut = sTonemapLuts.emplace(key, std::move(values)).first;
+        LOG2("%s, generate tonemap lut, type %d, gamma %f, size %d", __func__, type, gamma,
+             lutSize);
     }
 
-    MEMCPY_S(results->b_gamma_lut, lutSize * sizeof(float), results->g_gamma_lut,
-             lutSize * sizeof(float));
-    MEMCPY_S(results->r_gamma_lut, lutSize * sizeof(float), results->g_gamma_lut,
-             lutSize * sizeof(float));
+    size_t size = lutSize * sizeof(float);
+    MEMCPY_S(results->g_gamma_lut, size, lut->second.data(), size);
+    MEMCPY_S(results->b_gamma_lut, size, lut->second.data(), size);
+    MEMCPY_S(results->r_gamma_lut, size, lut->second.data(), size);
 }
 
-void AiqUtils::applyTonemapSRGB(cca::cca_gbce_params* results) {
+void AiqUtils::applyTonemapGamma(float gamma, cca::cca_gbce_params* results) {
+    CheckAndLogError(gamma < EPSILON, VOID_VALUE, "Bad gamma %f", gamma);
     CheckAndLogError(!results, VOID_VALUE, "gbce results nullptr");
 
-    int lutSize = results->gamma_lut_size;
-    CheckAndLogError(lutSize < MIN_TONEMAP_POINTS, VOID_VALUE,
-                     "Bad gamma lut size (%d) in gbce results", lutSize);
-    for (int i = 0; i < lutSize; i++) {
-        if (i / (lutSize - 1) < 0.0031308)
-            results->g_gamma_lut[i] = 12.92 * (i / (lutSize - 1));
-        else
-            results->g_gamma_lut[i] =
-                1.055 * pow(i / static_cast<float>(lutSize - 1), 1 / 2.4) - 0.055;
-    }
+    applyTonemapLut(TONEMAP_LUT_GAMMA, gamma, results);
+}
 
-    MEMCPY_S(results->b_gamma_lut, lutSize * sizeof(float), results->g_gamma_lut,
-             lutSize * sizeof(float));
-    MEMCPY_S(results->r_gamma_lut, lutSize * sizeof(float), results->g_gamma_lut,
-             lutSize * sizeof(float));
+void AiqUtils::applyTonemapSRGB(cca::cca_gbce_params* results) {
+    CheckAndLogError(!results, VOID_VALUE, "gbce results nullptr");
+
+    applyTonemapLut(TONEMAP_LUT_SRGB, 0, results);
 }
 
 void AiqUtils::applyTonemapREC709(cca::cca_gbce_params* results) {
     CheckAndLogError(!results, VOID_VALUE, "gbce results nullptr");
 
-    int lutSize = results->gamma_lut_size;
-    CheckAndLogError(lutSize < MIN_TONEMAP_POINTS, VOID_VALUE,
-                     "Bad gamma lut size (%d) in gbce results", lutSize);
-    for (int i = 0; i < lutSize; i++) {
-        if (i / (lutSize - 1) < 0.018)
-            results->g_gamma_lut[i] = 4.5 * (i / (lutSize - 1));
-        else
-            results->g_gamma_lut[i] =
-                1.099 * pow(i / static_cast<float>(lutSize - 1), 0.45) - 0.099;
+    applyTonemapLut(TONEMAP_LUT_REC709, 0, results);
+}
+
+/**
+ * Resize the 4 channels of the lens shading map with the bilinear interpolation of
+ * resize2dArray, and write them to the interleaved map directly.
+ * The interpolation positions and weights are shared by the channels, so they are calculated
+ * once for each row and column instead of once per channel and pixel.
+ */
+int AiqUtils::resizeLscGridRGGB(const uint16_t* const channels[4], int srcWidth, int srcHeight,
+                                float* dst, int dstWidth, int dstHeight) {
+    if (srcWidth < 2 || srcHeight < 2 || dstWidth < 2 || dstHeight < 2) return BAD_VALUE;
+
+    nsecs_t startTime = CameraUtils::systemTime();
+    const uint32_t kFracBits = FRAC_BITS_CURR_LOC;
+    const uint32_t kRounding = 1 << (2 * kFracBits - 1);
+    uint32_t stepW = ((srcWidth - 1) << kFracBits) / (dstWidth - 1);
+    uint32_t stepH = ((srcHeight - 1) << kFracBits) / (dstHeight - 1);
+
+    // The left position and the weights of the left and right points for each column
+    std::vector<uint32_t> colPos(dstWidth), colWeightL(dstWidth), colWeightR(dstWidth);
+    for (int i = 0; i < dstWidth; i++) {
+        uint32_t loc = i * stepW;
+        uint32_t lower = (loc > 0) ? (loc - 1) >> kFracBits : 0;
+        colPos[i] = lower;
+        colWeightL[i] = ((lower + 1) << kFracBits) - loc;
+        colWeightR[i] = loc - (lower << kFracBits);
+    }
+
+    for (int j = 0; j < dstHeight; j++) {
+        uint32_t loc = j * stepH;
+        uint32_t lower = (loc > 0) ? (loc - 1) >> kFracBits : 0;
+        uint32_t weightT = ((lower + 1) << kFracBits) - loc;
+        uint32_t weightB = loc - (lower << kFracBits);
+        size_t top = lower * srcWidth;
+        size_t bottom = top + srcWidth;
+
+        for (int i = 0; i < dstWidth; i++) {
+            size_t pos = colPos[i];
+            uint32_t wTL = colWeightL[i] * weightT;
+            uint32_t wTR = colWeightR[i] * weightT;
+            uint32_t wBL = colWeightL[i] * weightB;
+            uint32_t wBR = colWeightR[i] * weightB;
+
+            for (int c = 0; c < 4; c++) {
+                const uint16_t* src = channels[c];
+                uint32_t value = src[top + pos] * wTL + src[top + pos + 1] * wTR +
+                                 src[bottom + pos] * wBL + src[bottom + pos + 1] * wBR + kRounding;
+                *dst++ = static_cast<uint16_t>(value >> (2 * kFracBits));
+            }
+        }
     }
 
-    MEMCPY_S(results->b_gamma_lut, lutSize * sizeof(float), results->g_gamma_lut,
-             lutSize * sizeof(float));
-    MEMCPY_S(results->r_gamma_lut, lutSize * sizeof(float), results->g_gamma_lut,
-             lutSize * sizeof(float));
+    LOG2("%s: resize lens shading map from [%d,%d] to [%d,%d], cost %dus", __func__, srcWidth,
+         srcHeight, dstWidth, dstHeight,
+         (unsigned)((CameraUtils::systemTime() - startTime) / 1000));
+    return OK;
 }
 
 void AiqUtils::applyTonemapCurve(const camera_tonemap_curves_t& curves,
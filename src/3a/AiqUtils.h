@@ -173,6 +173,11 @@ template int resize2dArray<unsigned short>(const unsigned short* a_src, int a_sr
 template int resize2dArray<int>(const int* a_src, int a_src_w, int a_src_h, int* a_dst, int a_dst_w,
                                 int a_dst_h);
 
+// Resize the 4 channels of the lens shading map like resize2dArray, and write them to dst
+// interleaved in the order of channels (4 * dstWidth * dstHeight values)
+int resizeLscGridRGGB(const uint16_t* const channels[4], int srcWidth, int srcHeight, float* dst,
+                      int dstWidth, int dstHeight);
+
 float calculateHyperfocalDistance(const cca::cca_cmc& cmc);
 }  // namespace AiqUtils
 }  // namespace icamera
@@ -27,7 +27,7 @@
 
 namespace icamera {
 
-MakerNote::MakerNote() : mMknState(UNINIT) {}
+MakerNote::MakerNote() : mMknState(UNINIT), mRingHead(0) {}
 
 MakerNote::~MakerNote() {}
 
@@ -41,14 +41,17 @@ int MakerNote::init(int cameraId, TuningMode tuningMode) {
     IntelCca* intelCca = IntelCca::getInstance(cameraId, tuningMode);
     CheckAndLogError(!intelCca, BAD_VALUE, "@%s, Failed to get intelCca instance", __func__);
 
-    if (!mMakernoteDataList.size()) {
+    if (mMakernoteRing.empty()) {
+        mMakernoteRing.reserve(MAX_MAKER_NOTE_LIST_SIZE);
         for (int i = 0; i < MAX_MAKER_NOTE_LIST_SIZE; i++) {
             MakernoteData data;
             void* mknData = intelCca->allocMem(0, "mknData", i, sizeof(cca::cca_mkn));
             CheckAndLogError(!mknData, NO_MEMORY, "@%s, allocMem fails", __func__);
             data.mknData = static_cast<cca::cca_mkn*>(mknData);
-            mMakernoteDataList.push_back(data);
+            mMakernoteRing.push_back(data);
         }
+        mRingHead = 0;
+        mSequenceSlots.clear();
 
         mMknState = INIT;
     }
@@ -65,12 +68,12 @@ int MakerNote::deinit(int cameraId, TuningMode tuningMode) {
     IntelCca* intelCca = IntelCca::getInstance(cameraId, tuningMode);
     CheckAndLogError(!intelCca, BAD_VALUE, "@%s, Failed to get intelCca instance", __func__);
 
-    while (!mMakernoteDataList.empty()) {
-        MakernoteData data = mMakernoteDataList.front();
+    for (auto& data : mMakernoteRing) {
         intelCca->freeMem(data.mknData);
-        mMakernoteDataList.pop_front();
     }
-    mMakernoteDataList.clear();
+    mMakernoteRing.clear();
+    mSequenceSlots.clear();
+    mRingHead = 0;
 
     mMknState = UNINIT;
 
@@ -88,7 +91,7 @@ int MakerNote::saveMakernoteData(int cameraId, camera_makernote_mode_t makernote
 
     ia_mkn_trg mknTrg = ((makernoteMode == MAKERNOTE_MODE_JPEG) || dump ? ia_mkn_trg_section_1 :
                                                                           ia_mkn_trg_section_2);
-    MakernoteData data = mMakernoteDataList.front();
+    MakernoteData& data = mMakernoteRing[mRingHead];
 
     IntelCca* intelCca = IntelCca::getInstance(cameraId, tuningMode);
     CheckAndLogError(!intelCca, BAD_VALUE, "@%s, Failed to get intelCca instance", __func__);
@@ -107,12 +110,16 @@ int MakerNote::saveMakernoteData(int cameraId, camera_makernote_mode_t makernote
     }
 
     if (makernoteMode != MAKERNOTE_MODE_OFF) {
-        mMakernoteDataList.pop_front();
+        // The oldest makernote is overwritten, drop its index if it's still the latest one
+        auto slot = mSequenceSlots.find(data.sequence);
+        if (slot != mSequenceSlots.end() && slot->second == mRingHead) {
+            mSequenceSlots.erase(slot);
+        }
         data.sequence = sequence;
         data.timestamp = 0;
+        mSequenceSlots[sequence] = mRingHead;
+        mRingHead = (mRingHead + 1) % mMakernoteRing.size();
         LOG2("<seq%ld>@%s, saved makernote %d", sequence, __func__, makernoteMode);
-
-        mMakernoteDataList.push_back(data);
     }
     return OK;
 }
@@ -125,8 +132,7 @@ void* MakerNote::getMakernoteBuf(camera_makernote_mode_t makernoteMode, bool& du
     AutoMutex lock(mMknLock);
     CheckAndLogError(mMknState != INIT, nullptr, "@%s, mkn isn't initialized", __func__);
 
-    MakernoteData data = mMakernoteDataList.front();
-    return data.mknData;
+    return mMakernoteRing[mRingHead].mknData;
 }
 
 void MakerNote::updateTimestamp(int64_t sequence, uint64_t timestamp) {
@@ -134,12 +140,10 @@ void MakerNote::updateTimestamp(int64_t sequence, uint64_t timestamp) {
     AutoMutex lock(mMknLock);
     CheckAndLogError(mMknState != INIT, VOID_VALUE, "@%s, mkn isn't initialized", __func__);
 
-    for (auto rit = mMakernoteDataList.rbegin(); rit != mMakernoteDataList.rend(); ++rit) {
-        if ((*rit).sequence == sequence) {
-            LOG2("<seq%ld>@%s, update timestamp %ld", sequence, __func__, timestamp);
-            (*rit).timestamp = timestamp;
-            break;
-        }
+    auto slot = mSequenceSlots.find(sequence);
+    if (slot != mSequenceSlots.end()) {
+        LOG2("<seq%ld>@%s, update timestamp %ld", sequence, __func__, timestamp);
+        mMakernoteRing[slot->second].timestamp = timestamp;
     }
 }
 
@@ -147,11 +151,14 @@ void MakerNote::acquireMakernoteData(uint64_t timestamp, Parameters* param) {
     AutoMutex lock(mMknLock);
     CheckAndLogError(mMknState != INIT, VOID_VALUE, "@%s, mkn isn't initialized", __func__);
 
-    for (auto rit = mMakernoteDataList.rbegin(); rit != mMakernoteDataList.rend(); ++rit) {
-        if ((*rit).timestamp > 0 && timestamp >= (*rit).timestamp) {
-            LOG2("@%s, found timestamp %ld for request timestamp %ld", __func__, (*rit).timestamp,
+    // Search from the latest one, which is usually the one requested
+    int count = mMakernoteRing.size();
+    for (int i = 1; i <= count; i++) {
+        const MakernoteData& data = mMakernoteRing[(mRingHead + count - i) % count];
+        if (data.timestamp > 0 && timestamp >= data.timestamp) {
+            LOG2("@%s, found timestamp %ld for request timestamp %ld", __func__, data.timestamp,
                  timestamp);
-            param->setMakernoteData((*rit).mknData->buf, (*rit).mknData->size);
+            param->setMakernoteData(data.mknData->buf, data.mknData->size);
             break;
         }
     }
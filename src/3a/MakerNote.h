@@ -16,9 +16,10 @@
 
 #pragma once
 
-#include <list>
 #include <map>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 #ifdef ENABLE_SANDBOXING
 #include "modules/sandboxing/client/IntelCcaClient.h"
@@ -59,7 +60,7 @@ class MakerNote {
 
     /**
      * \brief init Makernote
-     * allocate memories for mMakernoteDataList by using IntelCca::allocMem()
+     * allocate memories for mMakernoteRing by using IntelCca::allocMem()
      *
      * param[in] int cameraId
      * param[in] TuningMode tuningMode
@@ -70,7 +71,7 @@ class MakerNote {
 
     /**
      * \brief deinit Makernote
-     * free memories for mMakernoteDataList by using IntelCca::freeMem()
+     * free memories for mMakernoteRing by using IntelCca::freeMem()
      *
      * param[in] int cameraId
      * param[in] TuningMode tuningMode
@@ -131,7 +132,11 @@ class MakerNote {
 
     // Guard for MakerNote API
     Mutex mMknLock;
-    std::list<MakernoteData> mMakernoteDataList;
+    // Fixed ring of makernotes, mRingHead is the oldest one which is written next
+    std::vector<MakernoteData> mMakernoteRing;
+    int mRingHead;
+    // <sequence, index in mMakernoteRing> of the saved makernotes
+    std::unordered_map<int64_t, int> mSequenceSlots;
 };
 
 }  // namespace icamera
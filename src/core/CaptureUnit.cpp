@@ -21,6 +21,8 @@
 #include <fcntl.h>
 #include <poll.h>
 
+#include <algorithm>
+
 #include "MediaControl.h"
 #include "PlatformData.h"
 #include "iutils/CameraDump.h"
@@ -137,6 +139,7 @@ int CaptureUnit::createDevices() {
 
         ret = device->configure(hasPort ? kTargetPort : kDefaultPort, stream, mMaxBufferNum);
         CheckAndLogError(ret != OK, ret, "Configure device(%s) failed:%d", device->getName(), ret);
+        mPollDevices.push_back(device->getV4l2Device());
     }
 
     return OK;
@@ -151,6 +154,7 @@ void CaptureUnit::destroyDevices() {
         delete device;
     }
     mDevices.clear();
+    mPollDevices.clear();
 }
 
 /**
@@ -353,23 +357,29 @@ void CaptureUnit::onDequeueBuffer() {
     processPendingBuffers();
 }
 
-int CaptureUnit::processPendingBuffers() {
-    LOG2("%s: buffers in device:%d", __func__, mDevices.front()->getBufferNumInDevice());
+int CaptureUnit::getQueueableRounds() {
+    int rounds = mMaxBuffersInDevice - mDevices.front()->getBufferNumInDevice();
+    // Do not queue buffer when one of the devices has no pending buffers.
+    for (auto device : mDevices) {
+        if (rounds <= 0) break;
+        rounds = std::min(rounds, device->getPendingBufferNum());
+    }
 
-    while (mDevices.front()->getBufferNumInDevice() < mMaxBuffersInDevice) {
-        bool hasPendingBuffer = true;
-        for (auto device : mDevices) {
-            if (!device->hasPendingBuffer()) {
-                hasPendingBuffer = false;
-                break;
-            }
-        }
-        // Do not queue buffer when one of the devices has no pending buffers.
-        if (!hasPendingBuffer) break;
+    return rounds;
+}
 
-        int ret = queueAllBuffers();
-        if (mExitPending) break;
-        CheckAndLogError(ret != OK, ret, "Failed to queue buffers, ret=%d", ret);
+int CaptureUnit::processPendingBuffers() {
+    // Queue all the rounds allowed in a burst, and check the devices again only after that
+    int rounds = getQueueableRounds();
+    LOG2("%s: rounds of buffers to queue:%d", __func__, rounds);
+
+    while (rounds > 0) {
+        for (; rounds > 0; rounds--) {
+            int ret = queueAllBuffers();
+            if (mExitPending) return OK;
+            CheckAndLogError(ret != OK, ret, "Failed to queue buffers, ret=%d", ret);
+        }
+        rounds = getQueueableRounds();
     }
 
     return OK;
@@ -388,11 +398,12 @@ int CaptureUnit::poll() {
 
     int timeOutCount = (PlatformData::getMaxIsysTimeout() > 0) ? PlatformData::getMaxIsysTimeout() :
                                                                  poll_timeout_count;
-    std::vector<V4L2Device*> pollDevs, readyDevices;
-    for (const auto& device : mDevices) {
-        pollDevs.push_back(device->getV4l2Device());
-        LOG2("@%s: device:%s has %d buffers queued.", __func__, device->getName(),
-             device->getBufferNumInDevice());
+    std::vector<V4L2Device*> readyDevices;
+    if (Log::isDebugLevelEnable(CAMERA_DEBUG_LOG_LEVEL2)) {
+        for (const auto& device : mDevices) {
+            LOG2("@%s: device:%s has %d buffers queued.", __func__, device->getName(),
+                 device->getBufferNumInDevice());
+        }
     }
 
     while (timeOutCount-- && ret == 0) {
@@ -403,7 +414,7 @@ int CaptureUnit::poll() {
             return -1;
         }
 
-        V4L2DevicePoller poller{pollDevs, mFlushFd[0]};
+        V4L2DevicePoller poller{mPollDevices, mFlushFd[0]};
         ret = poller.Poll(poll_timeout, POLLPRI | POLLIN | POLLOUT | POLLERR, &readyDevices);
     }
 
@@ -433,13 +444,13 @@ int CaptureUnit::poll() {
     }
 
     for (const auto& readyDevice : readyDevices) {
-        for (auto device : mDevices) {
-            if (device->getV4l2Device() == readyDevice) {
-                int ret = device->dequeueBuffer();
+        for (size_t i = 0; i < mPollDevices.size(); i++) {
+            if (mPollDevices[i] == readyDevice) {
+                int ret = mDevices[i]->dequeueBuffer();
                 if (mExitPending) return -1;
 
                 if (ret != OK) {
-                    LOGE("Device:%s grab frame failed:%d", device->getName(), ret);
+                    LOGE("Device:%s grab frame failed:%d", mDevices[i]->getName(), ret);
                 }
                 break;
             }
@@ -142,6 +142,7 @@ class CaptureUnit : public StreamSource, public DeviceCallback {
     int poll();
 
     int processPendingBuffers();
+    int getQueueableRounds();
     int queueAllBuffers();
 
  private:
@@ -169,6 +170,8 @@ class CaptureUnit : public StreamSource, public DeviceCallback {
     std::vector<ConfigMode> mConfigModes;
     std::map<Port, stream_t> mOutputFrameInfo;
     std::vector<DeviceBase*> mDevices;
+    // The V4L2 nodes of mDevices in the same order, for polling
+    std::vector<V4L2Device*> mPollDevices;
     uint32_t mMaxBufferNum;
 
     enum {
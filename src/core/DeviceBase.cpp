@@ -147,6 +147,8 @@ int DeviceBase::queueBuffer(int64_t sequence) {
             AutoMutex l(mBufferLock);
             mPendingBuffers.pop_front();
             mBuffersInDevice.push_back(buffer);
+            mBufferQueuing = false;
+            return OK;
         } else {
             LOGE("%s, index:%u size:%u, memory:%u, used:%u", __func__, buffer->getIndex(),
                  buffer->getBufferSize(), buffer->getMemory(), buffer->getBytesused());
@@ -216,6 +218,12 @@ bool DeviceBase::hasPendingBuffer() {
     return !mPendingBuffers.empty();
 }
 
+int DeviceBase::getPendingBufferNum() {
+    AutoMutex l(mBufferLock);
+
+    return mPendingBuffers.size();
+}
+
 void DeviceBase::addPendingBuffer(const shared_ptr<CameraBuffer>& buffer) {
     AutoMutex l(mBufferLock);
 
@@ -23,7 +23,7 @@
 #endif
 
 #include <atomic>
-#include <list>
+#include <deque>
 #include <set>
 
 #include "BufferQueue.h"
@@ -74,6 +74,7 @@ class DeviceBase : public EventSource {
     void removeAllFrameListeners() { mConsumers.clear(); }
 
     bool hasPendingBuffer();
+    int getPendingBufferNum();
     void addPendingBuffer(const std::shared_ptr<CameraBuffer>& buffer);
     int64_t getPredictSequence();
     int getBufferNumInDevice();
@@ -145,9 +146,9 @@ class DeviceBase : public EventSource {
      *    We must make the data consistent.
      */
     // Save all buffers allocated internally.
-    std::list<std::shared_ptr<CameraBuffer>> mPendingBuffers;
+    std::deque<std::shared_ptr<CameraBuffer>> mPendingBuffers;
     // The buffers that are going to be queued.
-    std::list<std::shared_ptr<CameraBuffer>> mBuffersInDevice;  // The buffers that have been queued
+    std::deque<std::shared_ptr<CameraBuffer>> mBuffersInDevice;  // The buffers that have been queued
     Mutex mBufferLock;  // The lock for protecting the internal buffers.
 
     uint32_t mMaxBufferNumber;
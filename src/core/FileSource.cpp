@@ -19,9 +19,13 @@
 #include "FileSource.h"
 
 #include <dirent.h>
+#include <errno.h>
 #include <expat.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 
 #include <algorithm>
 #include <fstream>
@@ -43,6 +47,7 @@ FileSource::FileSource(int cameraId)
           mCameraId(cameraId),
           mExitPending(false),
           mFps(30.0),
+          mFrameInterval(0),
           mSequence(-1),
           mOutputPort(INVALID_PORT) {
     LOG1("%s: FileSource is created for debugging.", __func__);
@@ -76,12 +81,14 @@ FileSource::FileSource(int cameraId)
     }
 
     CLEAR(mStreamConfig);
+    CLEAR(mNextFrameTime);
 
     mProduceThread = new ProduceThread(this);
 }
 
 FileSource::~FileSource() {
     delete mProduceThread;
+    unmapFrameFiles();
 }
 
 int FileSource::init() {
@@ -101,53 +108,98 @@ int FileSource::configure(const map<Port, stream_t>& outputFrames,
     return OK;
 }
 
-int FileSource::allocateSourceBuffer() {
-    int fmt = mStreamConfig.format;
-    int width = mStreamConfig.width;
-    int height = mStreamConfig.height;
-    // Get frame size with aligned height taking in count for internal buffers.
-    uint32_t size = CameraUtils::getFrameSize(fmt, width, height, true);
-    map<int, string> frameFileName;
+/**
+ * Resolve the frame files of all sequences and map them, the config file or the injection
+ * folder is parsed only once here instead of for every frame.
+ */
+int FileSource::loadFrameFiles() {
+    mFrameFiles.clear();
     if (mInjectionWay == USING_CONFIG_FILE) {
         FileSourceProfile profile(mInjectedFile);
+        map<int, string> frameFileName;
         int ret = profile.getFrameFiles(mCameraId, frameFileName);
         CheckAndLogError(ret != OK, BAD_VALUE, "Cannot find the frame files");
         for (const auto& item : frameFileName)
-            frameFileName[item.first] = profile.getFrameFile(mCameraId, item.first);
+            mFrameFiles[item.first] = profile.getFrameFile(mCameraId, item.first);
+        mFps = profile.getFps(mCameraId);
     } else if (mInjectionWay == USING_INJECTION_PATH) {
         int ret = access(mInjectedFile.c_str(), 0);
         CheckAndLogError(ret != OK, BAD_VALUE, "Cannot access: %s", mInjectedFile.c_str());
         FileSourceFromDir fSource(mInjectedFile);
-        ret = fSource.getInjectionFileInfo(&frameFileName);
+        ret = fSource.getInjectionFileInfo(&mFrameFiles);
         CheckAndLogError(ret != OK, BAD_VALUE, "Cannot find the frame files");
     } else if (mInjectionWay == USING_FRAME_FILE) {
-        frameFileName[0] = mInjectedFile;
+        mFrameFiles[0] = mInjectedFile;
     } else {
         CheckAndLogError(
             (mInjectionWay < USING_FRAME_FILE || mInjectionWay >= UNKNOWN_INJECTED_WAY), BAD_VALUE,
             "Invalid Injected Way");
     }
+    CheckAndLogError(mFrameFiles.empty(), BAD_VALUE, "No frame file to inject");
+    LOG1("<id%d>@%s, %zu frame files", mCameraId, __func__, mFrameFiles.size());
 
-    for (const auto& item : frameFileName) {
-        string fileName = item.second;
-        // Prepare the buffers to read the files for frame
-        shared_ptr<CameraBuffer> buf = CameraBuffer::create(
-            mCameraId, BUFFER_USAGE_GENERAL, V4L2_MEMORY_USERPTR, size, 0, fmt, width, height);
-        CheckAndLogError(!buf, BAD_VALUE, "@%s: Allocate producer buffer failed", __func__);
-        fillFrameBuffer(fileName, buf);
-        mFrameFileBuffers[fileName] = buf;
+    for (const auto& item : mFrameFiles) {
+        if (mMappedFrames.find(item.second) != mMappedFrames.end()) continue;
+
+        int ret = mapFrameFile(item.second);
+        CheckAndLogError(ret != OK, ret, "Failed to map frame file %s", item.second.c_str());
     }
+
+    return OK;
+}
+
+int FileSource::mapFrameFile(const string& fileName) {
+    int fd = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    CheckAndLogError(fd < 0, BAD_VALUE, "Cannot open frame file:%s", fileName.c_str());
+
+    struct stat statBuf;
+    if (fstat(fd, &statBuf) != 0 || statBuf.st_size <= 0) {
+        LOGE("Invalid frame file:%s", fileName.c_str());
+        close(fd);
+        return BAD_VALUE;
+    }
+
+    // Populate the pages when mapping, so that producing the frames doesn't wait for the disk
+    size_t size = statBuf.st_size;
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    CheckAndLogError(addr == MAP_FAILED, NO_MEMORY, "Failed to map frame file:%s, error %s",
+                     fileName.c_str(), strerror(errno));
+
+    uint32_t frameSize = CameraUtils::getFrameSize(mStreamConfig.format, mStreamConfig.width,
+                                                   mStreamConfig.height, true);
+    CheckWarningNoReturn(size < frameSize,
+                         "The size of file:%s is less than buffer's requirement.",
+                         fileName.c_str());
+
+    mMappedFrames[fileName] = {addr, size};
     return OK;
 }
 
+void FileSource::unmapFrameFiles() {
+    for (auto& item : mMappedFrames) {
+        munmap(item.second.addr, item.second.size);
+    }
+    mMappedFrames.clear();
+}
+
 int FileSource::start() {
     LOG1("%s", __func__);
 
     AutoMutex l(mLock);
 
-    allocateSourceBuffer();
+    // Pnp test mode, the frame files may be invalid, still produce the frames in this case
+    int ret = loadFrameFiles();
+    CheckWarningNoReturn(ret != OK, "Failed to load the frame files");
+
+    const char* injectedFps = getenv("cameraInjectFps");
+    if (injectedFps) mFps = strtof(injectedFps, nullptr);
+    mFrameInterval = mFps > 0 ? static_cast<int64_t>(1000000000.0 / mFps) : 0;
+    LOG1("<id%d>@%s, fps %f", mCameraId, __func__, mFps);
+
     mSequence = -1;
     mExitPending = false;
+    clock_gettime(CLOCK_MONOTONIC, &mNextFrameTime);
     mProduceThread->run("FileSource", PRIORITY_URGENT_AUDIO);
 
     return OK;
@@ -164,7 +216,7 @@ int FileSource::stop() {
     }
 
     mProduceThread->requestExitAndWait();
-    mFrameFileBuffers.clear();
+    unmapFrameFiles();
 
     return OK;
 }
@@ -190,8 +242,6 @@ bool FileSource::produce() {
     LOG2("%s", __func__);
 
     mSequence++;
-    struct timespec start, end;
-    clock_gettime(CLOCK_MONOTONIC, &start);
 
     static const nsecs_t kWaitDuration = 40000000000;  // 40s
     shared_ptr<CameraBuffer> qBuffer;
@@ -217,16 +267,7 @@ bool FileSource::produce() {
 
     fillFrameBuffer(qBuffer);
 
-    clock_gettime(CLOCK_MONOTONIC, &end);
-    long seconds = end.tv_sec - start.tv_sec;
-    long nSeconds = end.tv_nsec - start.tv_nsec;
-    // Check how long to sleep to meet the specified FPS requirement.
-    long sleepTime = static_cast<long>(1000000.0 / mFps) - (seconds * 1000000 + nSeconds / 1000);
-    LOG2("Need to sleep: %ld us", sleepTime);
-    // No need sleep if it takes too long to prepare the buffer.
-    if (sleepTime > 0) {
-        usleep(sleepTime);
-    }
+    waitForNextFrame();
 
     struct timespec stampTime;
     clock_gettime(CLOCK_MONOTONIC, &stampTime);
@@ -243,59 +284,46 @@ bool FileSource::produce() {
     return !mExitPending;
 }
 
-void FileSource::fillFrameBuffer(string fileName, shared_ptr<CameraBuffer>& buffer) {
-    CheckAndLogError(fileName.empty(), VOID_VALUE, "Invalid frame file.");
-    LOG2("Read frame from frame file:%s", fileName.c_str());
-
-    std::ifstream file(fileName.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
-    CheckAndLogError(!file.is_open(), VOID_VALUE, "Cannot open frame file:%s", fileName.c_str());
+/**
+ * Sleep until the absolute time of the next frame, so the time used to fill the frames doesn't
+ * accumulate into the frame interval.
+ */
+void FileSource::waitForNextFrame() {
+    if (mFrameInterval <= 0) return;
 
-    size_t fileSize = file.tellg();
-    file.seekg(0, std::ios::beg);
+    static const int64_t kNsPerSecond = 1000000000LL;
+    int64_t nextTime = mNextFrameTime.tv_sec * kNsPerSecond + mNextFrameTime.tv_nsec;
+    nextTime += mFrameInterval;
 
-    CheckWarningNoReturn(fileSize < buffer->getBufferSize(),
-                         "The size of file:%s is less than buffer's requirement.",
-                         fileName.c_str());
-    file.read(reinterpret_cast<char*>(buffer->getBufferAddr()),
-              std::min(fileSize, (size_t)buffer->getBufferSize()));
-}
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t nowTime = now.tv_sec * kNsPerSecond + now.tv_nsec;
+    // Restart the schedule from now if it's late for more than one frame, e.g. no buffer queued
+    if (nowTime - nextTime > mFrameInterval) nextTime = nowTime;
 
-void FileSource::fillFrameBuffer(shared_ptr<CameraBuffer>& buffer) {
-    string fileName;
+    mNextFrameTime.tv_sec = nextTime / kNsPerSecond;
+    mNextFrameTime.tv_nsec = nextTime % kNsPerSecond;
+    LOG2("Need to sleep: %ld us", static_cast<long>((nextTime - nowTime) / 1000));
 
-    if (mInjectionWay == USING_CONFIG_FILE) {
-        FileSourceProfile profile(mInjectedFile);
-        fileName = profile.getFrameFile(mCameraId, mSequence);
-        mFps = profile.getFps(mCameraId);
-    } else if (mInjectionWay == USING_INJECTION_PATH) {
-        if (access(mInjectedFile.c_str(), 0) != 0) {
-            LOGE("Cannot access:  %s for fillFrameBuffer", mInjectedFile.c_str());
-        }
-        map<int, string> frameFileName;
-        FileSourceFromDir fSource(mInjectedFile);
-        int ret = fSource.getInjectionFileInfo(&frameFileName);
-        if (ret != OK) {
-            LOGE("Cannot find the frame files for fillFrameBuffer");
-        }
-        fileName = fSource.getFrameFile(frameFileName, mSequence);
-    } else if (mInjectionWay == USING_FRAME_FILE) {
-        fileName = mInjectedFile;
-    } else {
-        LOGE("Invalid Injected Way for fillFrameBuffer");
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &mNextFrameTime, nullptr) == EINTR) {
     }
+}
 
-    CheckAndLogError(fileName.empty(), VOID_VALUE, "Invalid frame file.");
+void FileSource::fillFrameBuffer(shared_ptr<CameraBuffer>& buffer) {
+    // Use the frame file of the equal or most closest sequence before mSequence
+    auto frameFile = mFrameFiles.upper_bound(mSequence);
+    CheckAndLogError(frameFile == mFrameFiles.begin(), VOID_VALUE,
+                     "Cannot find the frame file for sequence:%ld", mSequence);
+    const string& fileName = (--frameFile)->second;
     LOG2("<seq%ld>Frame uses frame file:%s, buffer %p", mSequence, fileName.c_str(),
          buffer->getBufferAddr());
 
-    for (auto& item : mFrameFileBuffers) {
-        if (fileName.compare(item.first) == 0) {
-            MEMCPY_S((buffer->getBufferAddr()), buffer->getBufferSize(),
-                     (item.second->getBufferAddr()), item.second->getBufferSize());
-            return;
-        }
-    }
-    LOGE("Not find the framefile: %s", fileName.c_str());
+    auto mappedFrame = mMappedFrames.find(fileName);
+    CheckAndLogError(mappedFrame == mMappedFrames.end(), VOID_VALUE,
+                     "Not find the framefile: %s", fileName.c_str());
+
+    MEMCPY_S(buffer->getBufferAddr(), buffer->getBufferSize(), mappedFrame->second.addr,
+             mappedFrame->second.size);
 }
 
 void FileSource::notifyFrame(const shared_ptr<CameraBuffer>& buffer) {
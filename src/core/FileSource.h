@@ -36,6 +36,11 @@ namespace icamera {
  * 3. The third mode which can inject files in sequence by specifying injection folder path.
  *    How to enable: export cameraInjectFile="Injection Folder"
  *    ("Injection Folder" is the specifyed injection folder path you want to run file injection)
+ *
+ * The frame files are resolved and mapped once when starting, and the frames are produced
+ * at the FPS of the config file (30 by default), which can be overridden by:
+ *    export cameraInjectFps="FPS"
+ * Set it to 0 to produce the frames as fast as possible, for throughput testing.
  */
 class FileSource : public StreamSource {
  public:
@@ -62,9 +67,11 @@ class FileSource : public StreamSource {
 
  private:
     bool produce();
-    int allocateSourceBuffer();
+    int loadFrameFiles();
+    int mapFrameFile(const std::string& fileName);
+    void unmapFrameFiles();
+    void waitForNextFrame();
     void fillFrameBuffer(std::shared_ptr<CameraBuffer>& buffer);
-    void fillFrameBuffer(std::string fileName, std::shared_ptr<CameraBuffer>& buffer);
     void notifyFrame(const std::shared_ptr<CameraBuffer>& buffer);
     void notifySofEvent();
 
@@ -83,6 +90,9 @@ class FileSource : public StreamSource {
     bool mExitPending;
 
     float mFps;
+    // The interval of the frames in ns, 0 means producing the frames as fast as possible
+    int64_t mFrameInterval;
+    struct timespec mNextFrameTime;
     int64_t mSequence;
     std::string mInjectedFile;  // The injected file can be a actual frame or a XML config file.
     enum {
@@ -98,7 +108,13 @@ class FileSource : public StreamSource {
     Port mOutputPort;
 
     std::vector<BufferConsumer*> mBufferConsumerList;
-    std::map<std::string, std::shared_ptr<CameraBuffer>> mFrameFileBuffers;
+    // The frame files for the sequences, a frame file is used until the next one's sequence
+    std::map<int, std::string> mFrameFiles;
+    struct MappedFrame {
+        void* addr;
+        size_t size;
+    };
+    std::map<std::string, MappedFrame> mMappedFrames;
     CameraBufQ mBufferQueue;
     Condition mBufferSignal;
     // Guard for FileSource Public API
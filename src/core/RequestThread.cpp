@@ -36,6 +36,9 @@ RequestThread::RequestThread(int cameraId, AiqUnitBase* a3AControl, ParameterGen
           mFirstRequest(true),
           mActive(false),
           mRequestTriggerEvent(NONE_EVENT),
+          mWaitingForEvent(false),
+          mTriggerEventCount(0),
+          mWakeupCount(0),
           mLastRequestId(-1),
           mLastEffectSeq(-1),
           mLastAppliedSeq(-1),
@@ -79,6 +82,12 @@ void RequestThread::clearRequests() {
     }
 
     AutoMutex l(mPendingReqLock);
+    if (mTriggerEventCount > 0) {
+        LOG1("<id%d>@%s, %lu trigger events, %lu wakeups", mCameraId, __func__,
+             mTriggerEventCount, mWakeupCount);
+    }
+    mTriggerEventCount = 0;
+    mWakeupCount = 0;
     mRequestsInProcessing = 0;
     while (!mPendingRequests.empty()) {
         mPendingRequests.pop_back();
@@ -150,6 +159,24 @@ bool RequestThread::blockRequest() {
             (mPerframeControlSupport && (mRequestTriggerEvent == NONE_EVENT)));
 }
 
+void RequestThread::triggerRequest(int event) {
+    mTriggerEventCount++;
+    mRequestTriggerEvent |= event;
+
+    // The thread will check the events before waiting if it isn't waiting now
+    if (!mWaitingForEvent) return;
+
+    // Same as what the thread does when it's woken up but the request processing is still blocked
+    if (blockRequest()) {
+        mRequestTriggerEvent = NONE_EVENT;
+        return;
+    }
+
+    mWaitingForEvent = false;
+    mWakeupCount++;
+    mRequestSignal.signal();
+}
+
 int RequestThread::processRequest(int bufferNum, camera_buffer_t** ubuffer,
                                   const Parameters* params) {
     AutoMutex l(mPendingReqLock);
@@ -178,8 +205,7 @@ int RequestThread::processRequest(int bufferNum, camera_buffer_t** ubuffer,
     }
 
     if (mRequestsInProcessing == 0) {
-        mRequestTriggerEvent |= NEW_REQUEST;
-        mRequestSignal.signal();
+        triggerRequest(NEW_REQUEST);
     }
     return OK;
 }
@@ -248,8 +274,7 @@ void RequestThread::handleEvent(EventData eventData) {
             }
             // Just in case too many requests are pending in mPendingRequests.
             if (!mPendingRequests.empty() && (mRequestsInProcessing == 0)) {
-                mRequestTriggerEvent |= NEW_FRAME;
-                mRequestSignal.signal();
+                triggerRequest(NEW_FRAME);
             }
         } break;
         case EVENT_PSYS_STATS_BUF_READY: {
@@ -258,15 +283,13 @@ void RequestThread::handleEvent(EventData eventData) {
             if (mBlockRequest) {
                 mBlockRequest = false;
             }
-            mRequestTriggerEvent |= NEW_STATS;
-            mRequestSignal.signal();
+            triggerRequest(NEW_STATS);
         } break;
         case EVENT_ISYS_SOF: {
             AutoMutex l(mPendingReqLock);
             mLastSofSeq = eventData.data.sync.sequence;
             if (mLastSofSeq > mLastAppliedSeq) {
-                mRequestTriggerEvent |= NEW_SOF;
-                mRequestSignal.signal();
+                triggerRequest(NEW_SOF);
             }
         } break;
         case EVENT_FRAME_AVAILABLE: {
@@ -295,8 +318,7 @@ void RequestThread::handleEvent(EventData eventData) {
                 fakeRequest.mBuffer[0] = &mFakeReqBuf;
                 mFakeReqBuf.sequence = -1;
                 mPendingRequests.push_back(fakeRequest);
-                mRequestTriggerEvent |= NEW_REQUEST;
-                mRequestSignal.signal();
+                triggerRequest(NEW_REQUEST);
             }
         } break;
         default: {
@@ -328,7 +350,9 @@ bool RequestThread::threadLoop() {
         ConditionLock lock(mPendingReqLock);
 
         if (blockRequest()) {
+            mWaitingForEvent = true;
             int ret = mRequestSignal.waitRelative(lock, kWaitDuration * SLOWLY_MULTIPLIER);
+            mWaitingForEvent = false;
             if (ret == TIMED_OUT) {
                 LOG2("wait event time out, %d requests processing, %zu requests in HAL",
                      mRequestsInProcessing, mPendingRequests.size());
@@ -94,6 +94,8 @@ class RequestThread : public Thread, public EventSource, public EventListener {
 
     void handleRequest(CameraRequest& request, int64_t applyingSeq);
     bool blockRequest();
+    // Must be called with mPendingReqLock held
+    void triggerRequest(int event);
 
     static const int kMaxRequests = MAX_BUFFER_COUNT;
     static const nsecs_t kWaitFrameDuration = 5000000000;             // 5s
@@ -127,6 +129,12 @@ class RequestThread : public Thread, public EventSource, public EventListener {
         NEW_SOF = 1 << 3,
     };
     int mRequestTriggerEvent;
+    // The thread is waiting for the trigger events, only the first event which unblocks the
+    // request processing wakes it up, the following ones are coalesced into the event mask.
+    bool mWaitingForEvent;
+    // The trigger events and the thread wakeups for them, for debugging
+    uint64_t mTriggerEventCount;
+    uint64_t mWakeupCount;
 
     long mLastRequestId;
     int64_t mLastEffectSeq;   // Last sequence is which last results had been taken effect on
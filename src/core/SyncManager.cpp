@@ -143,6 +143,22 @@ bool SyncManager::vcSynced(int vc) {
     CheckAndLogError(vc >= MAX_CAMERA_NUMBER, false, "vc %d error", vc);
 
     AutoMutex l(mVcSyncLock);
+    return vcSyncedLocked(vc);
+}
+
+int SyncManager::waitVcSynced(int vc, int64_t timeoutNs) {
+    CheckAndLogError(vc >= MAX_CAMERA_NUMBER, BAD_VALUE, "vc %d error", vc);
+
+    ConditionLock lock(mVcSyncLock);
+    while (!vcSyncedLocked(vc)) {
+        int ret = mVcSyncSignal.waitRelative(lock, timeoutNs);
+        if (ret == TIMED_OUT) return vcSyncedLocked(vc) ? OK : TIMED_OUT;
+    }
+
+    return OK;
+}
+
+bool SyncManager::vcSyncedLocked(int vc) {
     int count = mVcSyncCount[vc];
     int minCount = INT_MAX;
     int maxCount = 0;
@@ -179,6 +195,8 @@ void SyncManager::updateVcSyncCount(int vc) {
     CheckAndLogError(vc >= MAX_CAMERA_NUMBER, VOID_VALUE, "vc %d error", vc);
     AutoMutex l(mVcSyncLock);
     mVcSyncCount[vc] = (mVcSyncCount[vc] + 1) % (max_vc_sync_count + 1);
+    // The min count may be changed, wake up the vcs which are waiting for this one
+    mVcSyncSignal.broadcast();
 }
 
 void SyncManager::printVcSyncCount(void) {
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "PlatformData.h"
+#include "iutils/Thread.h"
 
 namespace icamera {
 
@@ -45,6 +46,13 @@ class SyncManager {
     void updateSyncCamNum();
 
     bool vcSynced(int vc);
+    /**
+     * Block until the frame of this vc is not ahead of the other vcs, or the timeout expires.
+     * Woken up by updateVcSyncCount() of the other vcs instead of polling.
+     *
+     * \return OK if the vc is synced, TIMED_OUT if the timeout expires.
+     */
+    int waitVcSynced(int vc, int64_t timeoutNs);
     void updateVcSyncCount(int vc);
     void printVcSyncCount();
 
@@ -54,8 +62,11 @@ class SyncManager {
     Mutex mLock;
     struct camera_buf_info mCameraBufInfo[MAX_CAMERA_NUMBER][MAX_BUFFER_COUNT];
 
+    bool vcSyncedLocked(int vc);
+
     int mVcSyncCount[MAX_CAMERA_NUMBER];
     Mutex mVcSyncLock;
+    Condition mVcSyncSignal;
     int mTotalSyncCamNum;
 };
 
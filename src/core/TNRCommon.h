@@ -75,6 +75,8 @@ typedef struct TnrInitInfo {
     int height;
     int cameraId;
     TnrType type;
+    // Run the CPU backend instead of the GPU one, decided in the HAL with PlatformData
+    bool useCpuTnr;
 } TnrInitInfo;
 
 typedef struct TnrRequestInfo {
@@ -46,6 +46,8 @@ namespace icamera {
 
 #define STILL_TNR_THRESHOLD_GAIN_ID 722
 #define DEFAULT_TNR_THRESHOLD_GAIN 2.0f
+// Max count of the userptr output buffers registered to TNR
+#define MAX_TNR_OUT_SURFACE_COUNT MAX_BUFFER_COUNT
 
 std::mutex GPUExecutor::mGPULock;
 
@@ -56,7 +58,8 @@ GPUExecutor::GPUExecutor(int cameraId, const ExecutorPolicy& policy, vector<stri
           mIntelTNR(nullptr),
           mLastSequence(UINT32_MAX),
           mUseInternalTnrBuffer(useTnrOutBuffer),
-          mOutBufferSize(0) {
+          mOutBufferSize(0),
+          mTnrOutSurfaceFailed(false) {
     CLEAR(mStillTnrTriggerInfo);
     LOG1("Construct %s", mName.c_str());
 }
@@ -122,7 +125,8 @@ int GPUExecutor::start() {
                          "Can't find TerminalDescriptor");
 
         const FrameInfo& frameInfo = mTerminalsDesc[term].frameDesc;
-        mIntelTNR = std::unique_ptr<IntelTNR7US>(IntelTNR7US::createIntelTNR(mCameraId));
+        mIntelTNR = std::unique_ptr<IntelTNR7US>(
+            IntelTNR7US::createIntelTNR(mCameraId, PlatformData::isCpuTnrEnabled()));
         TnrType type = mStreamId == VIDEO_STREAM_ID ? TNR_INSTANCE0 : TNR_INSTANCE1;
         if (mIntelTNR) {
             ret = mIntelTNR->init(frameInfo.mWidth, frameInfo.mHeight, type);
@@ -154,7 +158,10 @@ void GPUExecutor::stop() {
     clearBufferQueues();
 
     delete mProcessThread;
+    // The surfaces are destroyed with the TNR instance
     mIntelTNR = nullptr;
+    mTnrOutSurfaces.clear();
+    mTnrOutSurfaceFailed = false;
 }
 
 int GPUExecutor::allocBuffers() {
@@ -223,18 +230,22 @@ int GPUExecutor::allocBuffers() {
 bool GPUExecutor::fetchTnrOutBuffer(int64_t seq, std::shared_ptr<CameraBuffer> buf) {
     if (!mUseInternalTnrBuffer) return false;
 
-    std::unique_lock<std::mutex> lock(mTnrOutBufMapLock);
-    if (mTnrOutBufMap.find(seq) != mTnrOutBufMap.end()) {
-        ScopeMapping mapper(buf);
-        void* pSrcBuf = mapper.getUserPtr();
-        CheckAndLogError(!pSrcBuf, false, "pSrcBuf is nullptr");
-        LOG2("Sequence %ld is used for output", seq);
-        MEMCPY_S(pSrcBuf, buf->getBufferSize(), mTnrOutBufMap[seq], mOutBufferSize);
-
-        return true;
+    // Hold a reference, so TNR doesn't reuse the buffer while it's copied without the lock
+    std::shared_ptr<void> tnrOutBuf;
+    {
+        std::unique_lock<std::mutex> lock(mTnrOutBufMapLock);
+        auto it = mTnrOutBufMap.find(seq);
+        if (it == mTnrOutBufMap.end()) return false;
+        tnrOutBuf = it->second;
     }
 
-    return false;
+    ScopeMapping mapper(buf);
+    void* pSrcBuf = mapper.getUserPtr();
+    CheckAndLogError(!pSrcBuf, false, "pSrcBuf is nullptr");
+    LOG2("Sequence %ld is used for output", seq);
+    MEMCPY_S(pSrcBuf, buf->getBufferSize(), tnrOutBuf.get(), mOutBufferSize);
+
+    return true;
 }
 
 int GPUExecutor::getStillTnrTriggerInfo(TuningMode mode) {
@@ -319,7 +330,7 @@ int GPUExecutor::allocTnrOutBufs(uint32_t bufSize) {
         // will release all buffer in freeAllBufs
         CheckAndLogError(!buffer, UNKNOWN_ERROR, "Alloc reference buffer fails");
         int index = i * (-1) - 1;  // initialize index as -1, -2, ...
-        mTnrOutBufMap[index] = buffer;
+        mTnrOutBufMap[index] = std::shared_ptr<void>(buffer, [](void*) {});
     }
     return OK;
 }
@@ -384,8 +395,10 @@ int GPUExecutor::processNewFrame() {
 
     std::shared_ptr<CameraBuffer> outBuf = outBuffers.begin()->second;
     CheckAndLogError(!outBuf, UNKNOWN_ERROR, "No valid output buffer");
+    // Nobody reads the internal output buffer, TNR only runs to keep its reference
+    bool outputUsed = outBuf != mInternalOutputBuffers[outBuffers.begin()->first];
 
-    ret = runTnrFrame(inBuf, outBuf);
+    ret = runTnrFrame(inBuf, outBuf, outputUsed);
     CheckAndLogError(ret != OK, ret, "Run tnr failed");
 
     if (CameraDump::isDumpTypeEnable(DUMP_GPU_TNR) && mStreamId == STILL_TNR_STREAM_ID) {
@@ -533,7 +546,7 @@ int GPUExecutor::updateTnrISPConfig(Tnr7Param* pbuffer, uint32_t sequence) {
 }
 
 int GPUExecutor::runTnrFrame(const std::shared_ptr<CameraBuffer>& inBuf,
-                             std::shared_ptr<CameraBuffer> outBuf) {
+                             std::shared_ptr<CameraBuffer> outBuf, bool outputUsed) {
     PERF_CAMERA_ATRACE();
     CheckAndLogError(!inBuf->getBufferAddr(), UNKNOWN_ERROR, "Invalid input buffer");
     int ret = OK;
@@ -594,14 +607,18 @@ int GPUExecutor::runTnrFrame(const std::shared_ptr<CameraBuffer>& inBuf,
 
     outBuf->setSequence(sequence);
     if (!mIntelTNR) {
-        MEMCPY_S(outPtr, bufferSize, inBuf->getBufferAddr(), inBuf->getBufferSize());
+        if (outputUsed) {
+            MEMCPY_S(outPtr, bufferSize, inBuf->getBufferAddr(), inBuf->getBufferSize());
+        }
         return OK;
     }
 
     if (icamera::PlatformData::isStillTnrPrior()) {
         // when running still stream tnr, should skip video tnr to decrease still capture duration.
         if (mStreamId == VIDEO_STREAM_ID && !mGPULock.try_lock()) {
-            MEMCPY_S(outPtr, bufferSize, inBuf->getBufferAddr(), inBuf->getBufferSize());
+            if (outputUsed) {
+                MEMCPY_S(outPtr, bufferSize, inBuf->getBufferAddr(), inBuf->getBufferSize());
+            }
             mLastSequence = UINT32_MAX;
             LOG2("Executor name:%s, skip frame sequence: %ld", mName.c_str(), inBuf->getSequence());
             return OK;
@@ -619,13 +636,33 @@ int GPUExecutor::runTnrFrame(const std::shared_ptr<CameraBuffer>& inBuf,
     void* dstBuf = outPtr;
     int dstSize = bufferSize;
     int dstFd = fd;
-    std::map<int64_t, void*>::iterator tnrOutBuf;
+    std::shared_ptr<void> tnrOutBuf;
     // use internal tnr buffer for ZSL and none APP buffer request usage
     bool useInternalBuffer = mUseInternalTnrBuffer || memoryType != V4L2_MEMORY_DMABUF;
+    if (!mUseInternalTnrBuffer && memoryType != V4L2_MEMORY_DMABUF &&
+        prepareTnrOutSurface(outBuf, outPtr, bufferSize)) {
+        // No one fetches the TNR result later, write to the userptr output directly to save
+        // the copy from the internal buffer.
+        useInternalBuffer = false;
+        dstFd = -1;
+    }
     if (useInternalBuffer) {
         std::unique_lock<std::mutex> lock(mTnrOutBufMapLock);
-        tnrOutBuf = mTnrOutBufMap.begin();
-        dstBuf = tnrOutBuf->second;
+        // Reuse the oldest buffer which isn't being fetched, and take it out of the map, so its
+        // old sequence can't be fetched while TNR overwrites it.
+        for (auto it = mTnrOutBufMap.begin(); it != mTnrOutBufMap.end(); ++it) {
+            if (it->second.use_count() > 1) continue;
+            LOG2("Reuse the tnr out buffer of sequence %ld", it->first);
+            tnrOutBuf = it->second;
+            mTnrOutBufMap.erase(it);
+            break;
+        }
+        if (!tnrOutBuf) {
+            if (icamera::PlatformData::isStillTnrPrior()) mGPULock.unlock();
+            LOGE("%s, no free tnr out buffer", mName.c_str());
+            return UNKNOWN_ERROR;
+        }
+        dstBuf = tnrOutBuf.get();
         dstSize = mOutBufferSize;
         // when use internal tnr buffer, we don't need to use fd map buffer
         dstFd = -1;
@@ -637,10 +674,10 @@ int GPUExecutor::runTnrFrame(const std::shared_ptr<CameraBuffer>& inBuf,
     ret = mIntelTNR->runTnrFrame(inBuf->getBufferAddr(), dstBuf, inBuf->getBufferSize(), dstSize,
                                  mTnr7usParam, paramSyncUpdate, dstFd);
     if (ret == OK) {
-        if (useInternalBuffer) {
-            MEMCPY_S(outPtr, bufferSize, tnrOutBuf->second, mOutBufferSize);
+        if (useInternalBuffer && outputUsed) {
+            MEMCPY_S(outPtr, bufferSize, tnrOutBuf.get(), mOutBufferSize);
         }
-    } else {
+    } else if (outputUsed) {
         LOG2("Just copy source buffer if run TNR failed");
         MEMCPY_S(outPtr, bufferSize, inBuf->getBufferAddr(), inBuf->getBufferSize());
     }
@@ -658,9 +695,8 @@ int GPUExecutor::runTnrFrame(const std::shared_ptr<CameraBuffer>& inBuf,
 
     if (useInternalBuffer) {
         std::unique_lock<std::mutex> lock(mTnrOutBufMapLock);
-        mTnrOutBufMap.erase(tnrOutBuf->first);
-        mTnrOutBufMap[sequence] = tnrOutBuf->second;
-        LOG2("outBuf->first %ld, outBuf->second %p", tnrOutBuf->first, tnrOutBuf->second);
+        mTnrOutBufMap[sequence] = tnrOutBuf;
+        LOG2("Sequence %u is in tnr out buffer %p", sequence, tnrOutBuf.get());
     }
 
     CheckAndLogError(ret != OK, UNKNOWN_ERROR, "tnr7us run frame failed");
@@ -670,6 +706,53 @@ int GPUExecutor::runTnrFrame(const std::shared_ptr<CameraBuffer>& inBuf,
     return ret;
 }
 
+bool GPUExecutor::prepareTnrOutSurface(const std::shared_ptr<CameraBuffer>& buf, void* bufAddr,
+                                       int bufSize) {
+#ifdef ENABLE_SANDBOXING
+    // The TNR in the sandbox can only access the shared memory it allocated
+    return false;
+#else
+    if (mTnrOutSurfaceFailed) return false;
+
+    // Release the surfaces of the freed buffers first, this buffer may reuse their address
+    releaseStaleTnrOutSurfaces();
+    auto surface = mTnrOutSurfaces.find(bufAddr);
+    if (surface != mTnrOutSurfaces.end()) {
+        if (surface->second.buffer.lock() == buf && surface->second.size == bufSize) return true;
+        mIntelTNR->releaseSurface(bufAddr);
+        mTnrOutSurfaces.erase(surface);
+    }
+    // The buffers of the pipe are reused, it's not worth to register more than that
+    if (mTnrOutSurfaces.size() >= MAX_TNR_OUT_SURFACE_COUNT) return false;
+
+    int ret = mIntelTNR->prepareSurface(bufAddr, bufSize);
+    if (ret != OK) {
+        // Don't try again for every frame, the internal buffer is used until the next start
+        LOGW("%s, failed to prepare TNR surface for %p, copy from the internal buffer",
+             mName.c_str(), bufAddr);
+        mTnrOutSurfaceFailed = true;
+        return false;
+    }
+    mTnrOutSurfaces[bufAddr] = {buf, bufSize};
+    LOG1("%s, TNR writes output buffer %p directly", mName.c_str(), bufAddr);
+    return true;
+#endif
+}
+
+void GPUExecutor::releaseStaleTnrOutSurfaces() {
+    for (auto it = mTnrOutSurfaces.begin(); it != mTnrOutSurfaces.end();) {
+        std::shared_ptr<CameraBuffer> buf = it->second.buffer.lock();
+        // The pages may be unmapped once the buffer is gone or its address changed
+        if (buf && buf->getBufferAddr() == it->first) {
+            ++it;
+            continue;
+        }
+        LOG1("%s, release the TNR surface of freed buffer %p", mName.c_str(), it->first);
+        mIntelTNR->releaseSurface(it->first);
+        it = mTnrOutSurfaces.erase(it);
+    }
+}
+
 int GPUExecutor::dumpTnrParameters(uint32_t sequence) {
     const int DUMP_FILE_SIZE = 0x1000;
     std::string dumpFileName =
@@ -19,6 +19,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "IntelCCATypes.h"
@@ -60,7 +61,10 @@ class GPUExecutor : public PipeLiteExecutor {
     int getTotalGain(int64_t seq, float* totalGain);
     int getStillTnrTriggerInfo(TuningMode mode);
     int runTnrFrame(const std::shared_ptr<CameraBuffer>& inBuf,
-                    std::shared_ptr<CameraBuffer> outbuf);
+                    std::shared_ptr<CameraBuffer> outbuf, bool outputUsed);
+    bool prepareTnrOutSurface(const std::shared_ptr<CameraBuffer>& buf, void* bufAddr,
+                              int bufSize);
+    void releaseStaleTnrOutSurfaces();
 
  private:
     Tnr7Param* mTnr7usParam;
@@ -73,8 +77,16 @@ class GPUExecutor : public PipeLiteExecutor {
     int mOutBufferSize;
     tnr7us_trigger_info_t mStillTnrTriggerInfo;
     std::mutex mTnrOutBufMapLock;  // used to guard mTnrOutBufMap
-    // first: sequence of source buffer, second: the reference buffer address
-    std::map<int64_t, void*> mTnrOutBufMap;
+    /* first: sequence of source buffer, second: the reference buffer, which is owned by
+     * mIntelTNR. A buffer held by fetchTnrOutBuffer isn't reused until it's released */
+    std::map<int64_t, std::shared_ptr<void>> mTnrOutBufMap;
+    struct TnrOutSurface {
+        std::weak_ptr<CameraBuffer> buffer;
+        int size;
+    };
+    // The userptr output buffers which TNR writes to directly, keyed by address
+    std::unordered_map<void*, TnrOutSurface> mTnrOutSurfaces;
+    bool mTnrOutSurfaceFailed;
 
     DISALLOW_COPY_AND_ASSIGN(GPUExecutor);
 };
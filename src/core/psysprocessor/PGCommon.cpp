@@ -33,6 +33,10 @@ namespace icamera {
 
 #define IS_VALID_TERMINAL(terminal) (terminal >= 0 && terminal < mTerminalCount)
 
+std::mutex PGCommon::sPGTemplateLock;
+std::map<int, std::vector<uint8_t>> PGCommon::sManifestCache;
+std::map<std::string, std::vector<uint8_t>> PGCommon::sPGTemplates;
+
 int PGCommon::getFrameSize(int format, int width, int height, bool needAlignedHeight,
                            bool needExtraSize, bool needCompression) {
     int size = 0;
@@ -86,7 +90,8 @@ PGCommon::PGCommon(int cameraId, int pgId, const std::string& pgName, TuningMode
           mOutputMainTerminal(-1),
           mShareReferPool(nullptr),
           mIpuParameters(nullptr),
-          mIntelCca(nullptr) {
+          mIntelCca(nullptr),
+          mMaxStatsSize(0) {
     mTnrTerminalPair.inId = -1;
     mTnrTerminalPair.outId = -1;
     CLEAR(mParamPayload);
@@ -135,6 +140,12 @@ int PGCommon::init() {
 }
 
 void PGCommon::deInit() {
+    if (mCmdPending) {
+        // Don't stop the PPG or free the command while the frame is still running
+        mCmdPending = false;
+        waitCmd();
+    }
+
     if (mPPGStarted) {
         stopPPG();
         mPPGStarted = false;
@@ -285,6 +296,7 @@ int PGCommon::prepare(IspParamAdaptor* adaptor, int statsCount, int streamId) {
     ret = mPGParamAdapt->prepare(adaptor->getIpuParameter(-1, streamId), mRoutingBitmap.get(),
                                  &mKernelBitmap, &maxStatsSize);
     CheckAndLogError((ret != OK), ret, "%s, prepare p2p fail", __func__);
+    mMaxStatsSize = maxStatsSize;
 
     // Init PG parameters
     ret = handlePGParams(mFrameFormatType.get());
@@ -349,11 +361,30 @@ ia_css_process_group_t* PGCommon::createPG(CIPR::Buffer** pgBuffer) {
     *pgBuffer = createUserPtrCiprBuffer(pgSize, pgMemory);
     CheckAndLogError(!*pgBuffer, nullptr, "%s, call createUserPtrCiprBuffer fail", __func__);
 
-    ia_css_process_group_t* pg = ia_css_process_group_create(
-        getCiprBufferPtr(*pgBuffer),
-        (ia_css_program_group_manifest_t*)getCiprBufferPtr(mManifestBuffer),
-        (ia_css_program_group_param_t*)getCiprBufferPtr(mPGParamsBuffer));
-    CheckAndLogError(!pg, nullptr, "Create process group failed.");
+    ia_css_process_group_t* pg = nullptr;
+    std::string templateKey = getPGTemplateKey(pgParamsBuf);
+    {
+        std::lock_guard<std::mutex> l(sPGTemplateLock);
+        auto it = sPGTemplates.find(templateKey);
+        if (it != sPGTemplates.end() && it->second.size() <= pgSize) {
+            MEMCPY_S(pgMemory, pgSize, it->second.data(), it->second.size());
+            pg = static_cast<ia_css_process_group_t*>(pgMemory);
+            LOG1("%s, %s uses the PG template", __func__, getName());
+        }
+    }
+
+    if (!pg) {
+        pg = ia_css_process_group_create(
+            getCiprBufferPtr(*pgBuffer),
+            (ia_css_program_group_manifest_t*)getCiprBufferPtr(mManifestBuffer),
+            (ia_css_program_group_param_t*)getCiprBufferPtr(mPGParamsBuffer));
+        CheckAndLogError(!pg, nullptr, "Create process group failed.");
+
+        const uint8_t* pgData = reinterpret_cast<const uint8_t*>(pg);
+        std::lock_guard<std::mutex> l(sPGTemplateLock);
+        if (sPGTemplates.size() >= kMaxPGTemplateCount) sPGTemplates.clear();
+        sPGTemplates[templateKey].assign(pgData, pgData + ia_css_process_group_get_size(pg));
+    }
 
     ia_css_process_group_set_num_queues(pg, 1);
 
@@ -363,6 +394,15 @@ ia_css_process_group_t* PGCommon::createPG(CIPR::Buffer** pgBuffer) {
     return pg;
 }
 
+std::string PGCommon::getPGTemplateKey(const ia_css_program_group_param_t* pgParams) {
+    // The params hold the kernel bitmap, fragment count and the formats and sizes of terminals
+    size_t paramsSize =
+        ia_css_sizeof_program_group_param(mProgramCount, mTerminalCount, mFragmentCount);
+    std::string key(reinterpret_cast<const char*>(&mPGId), sizeof(mPGId));
+    key.append(reinterpret_cast<const char*>(pgParams), paramsSize);
+    return key;
+}
+
 int PGCommon::createCommands() {
     int bufCount = ia_css_process_group_get_terminal_count(mProcessGroup);
     int ret = createCommand(mPGBuffer, &mCmd, &mCmdExtBuffer, bufCount);
@@ -880,11 +920,27 @@ int PGCommon::iterate(CameraBufferMap& inBufs, CameraBufferMap& outBufs, ia_bina
                       const ia_binary_data* ipuParameters) {
     PERF_CAMERA_ATRACE();
 
+    int ret = prepareIteration(inBufs, outBufs, ipuParameters);
+    CheckAndLogError((ret != OK), ret, "%s, prepareIteration fail with %d", getName(), ret);
+
+    ret = submitIteration();
+    CheckAndLogError((ret != OK), ret, "%s, submitIteration fail with %d", getName(), ret);
+
+    return completeIteration(statistics);
+}
+
+int PGCommon::prepareIteration(CameraBufferMap& inBufs, CameraBufferMap& outBufs,
+                               const ia_binary_data* ipuParameters) {
+    PERF_CAMERA_ATRACE();
+    CheckAndLogError(mCmdPending, INVALID_OPERATION, "%s, <seq%ld> is still in flight", getName(),
+                     mIterateSequence);
+
     int64_t sequence = 0;
     if (!inBufs.empty()) {
         sequence = inBufs.begin()->second->getSequence();
     }
     LOG2("<seq%ld>%s:%s ++", sequence, getName(), __func__);
+    mIterateSequence = sequence;
 
     int ret = prepareTerminalBuffers(ipuParameters, inBufs, outBufs, sequence);
     CheckAndLogError((ret != OK), ret, "%s, prepareTerminalBuffers fail with %d", getName(), ret);
@@ -909,15 +965,38 @@ int PGCommon::iterate(CameraBufferMap& inBufs, CameraBufferMap& outBufs, ia_bina
         CheckAndLogError((ret != OK), ret, "%s, call createCommands fail", __func__);
     }
 
+    return OK;
+}
+
+int PGCommon::submitIteration() {
+    PERF_CAMERA_ATRACE();
+    CheckAndLogError(mCmdPending, INVALID_OPERATION, "%s, <seq%ld> is still in flight", getName(),
+                     mIterateSequence);
+
     if (!mPPGStarted) {
-        ret = startPPG();
+        int ret = startPPG();
         CheckAndLogError((ret != OK), ret, "%s, startPPG fail", getName());
         mPPGStarted = true;
     }
 
-    ret = executePG();
+    // Only the last fragment is left running, the caller waits for it in completeIteration()
+    int ret = executePG(false);
     CheckAndLogError((ret != OK), ret, "%s, executePG fail", getName());
 
+    return OK;
+}
+
+int PGCommon::completeIteration(ia_binary_data* statistics) {
+    PERF_CAMERA_ATRACE();
+    int64_t sequence = mIterateSequence;
+
+    int ret = OK;
+    if (mCmdPending) {
+        mCmdPending = false;
+        ret = waitCmd();
+        CheckAndLogError((ret != OK), ret, "%s, <seq%ld> PG execution fail", getName(), sequence);
+    }
+
     if (statistics) {
         bool useCcaBuf = false;
         if (mIntelCca && !statistics->data) {
@@ -931,7 +1010,8 @@ int PGCommon::iterate(CameraBufferMap& inBufs, CameraBufferMap& outBufs, ia_bina
         }
     }
 
-    postTerminalBuffersDone(sequence);
+    ret = postTerminalBuffersDone(sequence);
+    CheckAndLogError((ret != OK), ret, "%s, postTerminalBuffersDone fail with %d", getName(), ret);
     LOG2("<seq%ld>%s:%s -- ", sequence, getName(), __func__);
     return ret;
 }
@@ -1149,21 +1229,26 @@ int PGCommon::prepareTerminalBuffers(const ia_binary_data* ipuParameters,
     return mPGParamAdapt->updatePALAndEncode(ipuParameters, mTerminalCount, mParamPayload);
 }
 
-void PGCommon::postTerminalBuffersDone(int64_t sequence) {
+int PGCommon::postTerminalBuffersDone(int64_t sequence) {
+    // Release all the refer buffers even if one fails, and return the first error
+    int ret = OK;
     if (!mTnrDataBuffers.empty() && mShareReferIds[mTnrTerminalPair.inId]) {
-        mShareReferPool->releaseBuffer(mShareReferIds[mTnrTerminalPair.inId],
-                                       mTerminalBuffers[mTnrTerminalPair.inId],
-                                       mTerminalBuffers[mTnrTerminalPair.outId], sequence);
+        ret = mShareReferPool->releaseBuffer(mShareReferIds[mTnrTerminalPair.inId],
+                                             mTerminalBuffers[mTnrTerminalPair.inId],
+                                             mTerminalBuffers[mTnrTerminalPair.outId], sequence);
     }
     for (auto pair : mTnrSimTerminalPairs) {
         if (mShareReferIds[pair.inId]) {
-            mShareReferPool->releaseBuffer(mShareReferIds[pair.inId], mTerminalBuffers[pair.inId],
-                                           mTerminalBuffers[pair.outId], sequence);
+            int status = mShareReferPool->releaseBuffer(mShareReferIds[pair.inId],
+                                                        mTerminalBuffers[pair.inId],
+                                                        mTerminalBuffers[pair.outId], sequence);
+            if (ret == OK) ret = status;
         }
     }
+    return ret;
 }
 
-int PGCommon::executePG() {
+int PGCommon::executePG(bool waitLastFragment) {
     PERF_CAMERA_ATRACE();
     TRACE_LOG_PROCESS(mName.c_str(), __func__);
     CheckAndLogError((!mCmd), INVALID_OPERATION, "%s, Command is invalid.", __func__);
@@ -1194,8 +1279,14 @@ int PGCommon::executePG() {
         ret = ia_css_process_group_set_fragment_limit(mProcessGroup, (uint16_t)(fragIdx + 1));
         CheckAndLogError((ret != OK), ret, "%s, set fragment limit %d fail", getName(), fragIdx);
 
-        ret = handleCmd(&mCmd, &mCmdCfg);
-        CheckAndLogError((ret != OK), ret, "%s, call handleCmd fail", getName());
+        if (!waitLastFragment && fragIdx == mFragmentCount - 1) {
+            ret = submitCmd(&mCmd, &mCmdCfg);
+            CheckAndLogError((ret != OK), ret, "%s, call submitCmd fail", getName());
+            mCmdPending = true;
+        } else {
+            ret = handleCmd(&mCmd, &mCmdCfg);
+            CheckAndLogError((ret != OK), ret, "%s, call handleCmd fail", getName());
+        }
     }
 
     return OK;
@@ -1243,10 +1334,14 @@ int PGCommon::stopPPG() {
 }
 
 int PGCommon::handleCmd(CIPR::Command** cmd, CIPR::PSysCommandConfig* cmdCfg) {
-    CIPR::PSysEventConfig eventCfg = {};
-    mEvent->getConfig(&eventCfg);
+    int ret = submitCmd(cmd, cmdCfg);
+    CheckAndLogError((ret != OK), ret, "%s, submitCmd fail", __func__);
+
+    return waitCmd();
+}
+
+int PGCommon::submitCmd(CIPR::Command** cmd, CIPR::PSysCommandConfig* cmdCfg) {
     cmdCfg->issueID = reinterpret_cast<uint64_t>(cmd);
-    eventCfg.commandIssueID = cmdCfg->issueID;
 
     CIPR::Result ret = (*cmd)->setConfig(*cmdCfg);
     CheckAndLogError((ret != CIPR::Result::OK), UNKNOWN_ERROR,
@@ -1260,8 +1355,13 @@ int PGCommon::handleCmd(CIPR::Command** cmd, CIPR::PSysCommandConfig* cmdCfg) {
     CheckAndLogError((ret != CIPR::Result::OK), UNKNOWN_ERROR,
                      "%s, call Context::enqueueCommand() fail %d", __func__, ret);
 
-    // Wait event
-    ret = mEvent->wait(mCtx);
+    return OK;
+}
+
+int PGCommon::waitCmd() {
+    CIPR::PSysEventConfig eventCfg = {};
+
+    CIPR::Result ret = mEvent->wait(mCtx);
     CheckAndLogError((ret != CIPR::Result::OK), UNKNOWN_ERROR,
                      "%s, call Context::waitForEvent fail, ret: %d", __func__, ret);
 
@@ -1300,61 +1400,58 @@ int PGCommon::getCapability() {
 }
 
 int PGCommon::getManifest(int pgId) {
-    int i = 0;
-
-    for (; i < mPGCount; i++) {
-        CIPR::Buffer* manifestBuffer = nullptr;
-        int programCount = 0;
-        int terminalCount = 0;
-        int programGroupId = 0;
-        int manifestSize = 0;
-        ia_css_kernel_bitmap_t kernelBitmap = ia_css_kernel_bitmap_clear();
-        uint32_t size = 0;
-
-        CIPR::Result ret = mCtx->getManifest(i, &size, nullptr);
-        if (ret != CIPR::Result::OK) continue;
-        CheckAndLogError((size == 0), UNKNOWN_ERROR, "%s, the manifest size is 0", __func__);
-
-        manifestBuffer = createUserPtrCiprBuffer(size);
-        CheckAndLogError(!manifestBuffer, NO_MEMORY, "%s, call createUserPtrCiprBuffer fail",
-                         __func__);
-
-        void* manifest = getCiprBufferPtr(manifestBuffer);
-
-        ret = mCtx->getManifest(i, &size, manifest);
-        if (ret != CIPR::Result::OK) {
-            LOGE("%s, call Context::getManifest() fail", __func__);
-            delete manifestBuffer;
-            return UNKNOWN_ERROR;
-        }
+    std::lock_guard<std::mutex> l(sPGTemplateLock);
+    // Query all manifests at the first time, instead of scanning them again for each PG
+    if (sManifestCache.empty()) {
+        for (int i = 0; i < mPGCount; i++) {
+            uint32_t size = 0;
+            CIPR::Result ret = mCtx->getManifest(i, &size, nullptr);
+            if (ret != CIPR::Result::OK) continue;
+            CheckAndLogError((size == 0), UNKNOWN_ERROR, "%s, the manifest size is 0", __func__);
+
+            std::vector<uint8_t> manifest(size);
+            ret = mCtx->getManifest(i, &size, manifest.data());
+            if (ret != CIPR::Result::OK) {
+                LOGE("%s, call Context::getManifest() fail", __func__);
+                sManifestCache.clear();
+                return UNKNOWN_ERROR;
+            }
 
-        LOG1("%s: pg index: %d, manifest size: %u", __func__, i, size);
-        const ia_css_program_group_manifest_t* mf =
-            (const ia_css_program_group_manifest_t*)manifest;
-        programCount = ia_css_program_group_manifest_get_program_count(mf);
-        terminalCount = ia_css_program_group_manifest_get_terminal_count(mf);
-        programGroupId = ia_css_program_group_manifest_get_program_group_ID(mf);
-        manifestSize = ia_css_program_group_manifest_get_size(mf);
-        kernelBitmap = ia_css_program_group_manifest_get_kernel_bitmap(mf);
-
-        LOG1("%s: pgIndex: %d, programGroupId: %d, manifestSize: %d, programCount: %d,"
-             "terminalCount: %d",
-             __func__, i, programGroupId, manifestSize, programCount, terminalCount);
-
-        if (pgId == programGroupId) {
-            mProgramCount = programCount;
-            mTerminalCount = terminalCount;
-            mManifestSize = manifestSize;
-            mKernelBitmap = kernelBitmap;
-            mManifestBuffer = manifestBuffer;
-            break;
+            LOG1("%s: pg index: %d, manifest size: %u", __func__, i, size);
+            const ia_css_program_group_manifest_t* mf =
+                (const ia_css_program_group_manifest_t*)manifest.data();
+            int programGroupId = ia_css_program_group_manifest_get_program_group_ID(mf);
+            LOG1("%s: pgIndex: %d, programGroupId: %d, manifestSize: %d, programCount: %d,"
+                 "terminalCount: %d",
+                 __func__, i, programGroupId, ia_css_program_group_manifest_get_size(mf),
+                 ia_css_program_group_manifest_get_program_count(mf),
+                 ia_css_program_group_manifest_get_terminal_count(mf));
+            if (sManifestCache.find(programGroupId) == sManifestCache.end()) {
+                sManifestCache[programGroupId] = std::move(manifest);
+            }
         }
+    }
+
+    auto it = sManifestCache.find(pgId);
+    CheckAndLogError(it == sManifestCache.end(), BAD_VALUE, "%s, Can't found available pg: %d",
+                     __func__, pgId);
 
+    CIPR::Buffer* manifestBuffer = createUserPtrCiprBuffer(it->second.size());
+    CheckAndLogError(!manifestBuffer, NO_MEMORY, "%s, call createUserPtrCiprBuffer fail",
+                     __func__);
+    void* manifest = getCiprBufferPtr(manifestBuffer);
+    if (!manifest) {
         delete manifestBuffer;
+        return NO_MEMORY;
     }
+    MEMCPY_S(manifest, it->second.size(), it->second.data(), it->second.size());
 
-    CheckAndLogError((i == mPGCount), BAD_VALUE, "%s, Can't found available pg: %d", __func__,
-                     pgId);
+    const ia_css_program_group_manifest_t* mf = (const ia_css_program_group_manifest_t*)manifest;
+    mProgramCount = ia_css_program_group_manifest_get_program_count(mf);
+    mTerminalCount = ia_css_program_group_manifest_get_terminal_count(mf);
+    mManifestSize = ia_css_program_group_manifest_get_size(mf);
+    mKernelBitmap = ia_css_program_group_manifest_get_kernel_bitmap(mf);
+    mManifestBuffer = manifestBuffer;
 
     return OK;
 }
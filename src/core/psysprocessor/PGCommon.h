@@ -28,7 +28,10 @@ extern "C" {
 #include <ia_css_terminal_types.h>
 }
 
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
 #ifdef ENABLE_SANDBOXING
@@ -70,12 +73,14 @@ typedef std::map<ia_uid, std::shared_ptr<CameraBuffer>> CameraBufferMap;
  *          setKernelBitMap();
  *          setTerminalParams();
  *          allocatePGBuffer();
+ *          createPG(); (copied from the PG template of the same params if there is one)
  *          setPGAndPrepareProgram();
  *          configureFragmentDesc();
- * 5. loop frame: iterate():
+ * 5. loop frame: iterate(), or the split form
+ *    prepareIteration(); submitIteration(); completeIteration():
  *          encodeTerminals();
- *          handleCmd();
- *          handleEvent();
+ *          submitCmd();
+ *          waitCmd();
  *          decode();
  * 6. deInit();
  */
@@ -135,8 +140,24 @@ class PGCommon {
     virtual int iterate(CameraBufferMap& inBufs, CameraBufferMap& outBufs,
                         ia_binary_data* statistics, const ia_binary_data* ipuParameters);
 
+    /**
+     * Split form of iterate(), which lets the caller do CPU work while the PG runs in hardware.
+     * prepareIteration() encodes the terminals, submitIteration() enqueues the PG command
+     * without waiting for it, and completeIteration() waits for the PG, decodes the statistics
+     * and returns the terminal buffers. Only one iteration can be in flight per PG.
+     */
+    int prepareIteration(CameraBufferMap& inBufs, CameraBufferMap& outBufs,
+                         const ia_binary_data* ipuParameters);
+    int submitIteration();
+    int completeIteration(ia_binary_data* statistics);
+
     const char* getName() { return mName.c_str(); }
 
+    /**
+     * the max size of the serialized statistics, valid after prepare()
+     */
+    uint32_t getMaxStatsSize() const { return mMaxStatsSize; }
+
  private:
     DISALLOW_COPY_AND_ASSIGN(PGCommon);
 
@@ -155,6 +176,7 @@ class PGCommon {
     int configureTerminalFragmentDesc(int termIdx, const ia_p2p_fragment_desc* srcDesc);
     int configureFrameDesc();
     ia_css_process_group_t* createPG(CIPR::Buffer** pgBuffer);
+    std::string getPGTemplateKey(const ia_css_program_group_param_t* pgParams);
     int createCommands();
     int createCommand(CIPR::Buffer* pg, CIPR::Command** cmd, CIPR::Buffer** extBuffer,
                       int bufCount);
@@ -167,12 +189,14 @@ class PGCommon {
     virtual int prepareTerminalBuffers(const ia_binary_data* ipuParameters,
                                        const CameraBufferMap& inBufs,
                                        const CameraBufferMap& outBufs, int64_t sequence);
-    int executePG();
+    int executePG(bool waitLastFragment = true);
     int startPPG();
     int stopPPG();
     int handleCmd(CIPR::Command** cmd, CIPR::PSysCommandConfig* cmdCfg);
+    int submitCmd(CIPR::Command** cmd, CIPR::PSysCommandConfig* cmdCfg);
+    int waitCmd();
 
-    void postTerminalBuffersDone(int64_t sequence);
+    int postTerminalBuffersDone(int64_t sequence);
 
     // Memory helper
     CIPR::Buffer* createDMACiprBuffer(int size, int fd, bool flush = false);
@@ -196,6 +220,18 @@ class PGCommon {
     };
 
     static const int kEventTimeout = 8000;
+    static const size_t kMaxPGTemplateCount = 64;
+
+    /*
+     * The manifests come from the firmware and the process group created from the same
+     * manifest and params is always the same, so both are shared by all PGs and kept
+     * across configure and camera reopen.
+     */
+    static std::mutex sPGTemplateLock;
+    // <pg id, manifest>
+    static std::map<int, std::vector<uint8_t>> sManifestCache;
+    // <pg id + program group params, process group>
+    static std::map<std::string, std::vector<uint8_t>> sPGTemplates;
 
     CIPR::Context* mCtx = nullptr;
     CIPR::Buffer* mManifestBuffer = nullptr;
@@ -240,6 +276,9 @@ class PGCommon {
 
     CIPR::PSysCommandConfig mCmdCfg;
     CIPR::Event* mEvent = nullptr;
+    // The last fragment of the frame command is submitted but not waited yet
+    bool mCmdPending = false;
+    int64_t mIterateSequence = -1;
 
     CIPR::Buffer** mTerminalBuffers;
 
@@ -260,6 +299,7 @@ class PGCommon {
 
     const ia_binary_data* mIpuParameters;
     IntelCca* mIntelCca;
+    uint32_t mMaxStatsSize;
 };
 
 }  // namespace icamera
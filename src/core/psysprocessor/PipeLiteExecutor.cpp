@@ -18,6 +18,9 @@
 
 #include "PipeLiteExecutor.h"
 
+#include <errno.h>
+#include <time.h>
+
 #include <algorithm>
 
 #include "PSysDAG.h"
@@ -45,6 +48,9 @@ static const int32_t sStatKernels[] = {ia_pal_uuid_isp_bxt_awbstatistics,
 
 static const int32_t sSisKernels[] = {ia_pal_uuid_isp_sis_1_0_a};
 
+// The stats are serialized to the pages behind the ia_binary_data header of the stats buffer
+static const size_t kStatsDataOffset = PAGE_ALIGN(sizeof(ia_binary_data));
+
 PipeLiteExecutor::PipeLiteExecutor(int cameraId, const ExecutorPolicy& policy,
                                    vector<string> exclusivePGs, PSysDAG* psysDag,
                                    shared_ptr<IGraphConfig> gc)
@@ -62,6 +68,11 @@ PipeLiteExecutor::PipeLiteExecutor(int cameraId, const ExecutorPolicy& policy,
           mPolicyManager(nullptr),
           mShareReferPool(nullptr),
           mLastStatsSequence(-1),
+          mStatsDecodeExit(false),
+          mStatsDecodeCount(0),
+          mStatsDropCount(0),
+          mStatsDecodeTotalLatency(0),
+          mStatsDecodeMaxLatency(0),
           mExclusivePGs(exclusivePGs),
           mPSysDag(psysDag),
           mkernelsCountWithStats(0),
@@ -390,6 +401,8 @@ int PipeLiteExecutor::start() {
     if (mPolicyManager) mProcessThread = new ProcessThread(this);
     AutoMutex l(mBufferQueueLock);
 
+    // The stats buffers are allocated with the stats memory if they are decoded asynchronously
+    startStatsDecodeThread();
     allocBuffers();
     dumpPGs();
 
@@ -407,6 +420,7 @@ void PipeLiteExecutor::stop() {
     LOG1("%s executor:%s", __func__, mName.c_str());
 
     if (mProcessThread) mProcessThread->requestExitAndWait();
+    stopStatsDecodeThread();
 
     // Thread is not running. It is safe to clear the Queue
     clearBufferQueues();
@@ -633,19 +647,30 @@ int PipeLiteExecutor::processNewFrame() {
 // Allow +/- 3ms delay
 #define SYS_TRIGGER_DELTA    (3)
     if (mMsOfPsysAlignWithSystem) {
-        timeval curTime;
-        gettimeofday(&curTime, nullptr);
-        int64_t ms = (curTime.tv_usec / 1000) % mMsOfPsysAlignWithSystem;
-        int64_t waitMs = 0;
-
-        if ((ms <= SYS_TRIGGER_DELTA) || ((mMsOfPsysAlignWithSystem - ms) <= SYS_TRIGGER_DELTA))
-            waitMs = 0;
+        // The phase is taken on CLOCK_MONOTONIC, which all the cameras share and which isn't
+        // stepped by the wall clock, and the sleep is to an absolute deadline
+        const int64_t periodNs = static_cast<int64_t>(mMsOfPsysAlignWithSystem) * 1000000;
+        timespec curTime;
+        clock_gettime(CLOCK_MONOTONIC, &curTime);
+        int64_t curNs = static_cast<int64_t>(curTime.tv_sec) * 1000000000 + curTime.tv_nsec;
+        int64_t phaseNs = curNs % periodNs;
+        int64_t waitNs = 0;
+
+        if ((phaseNs <= SYS_TRIGGER_DELTA * 1000000) ||
+            ((periodNs - phaseNs) <= SYS_TRIGGER_DELTA * 1000000))
+            waitNs = 0;
         else
-            waitMs  = mMsOfPsysAlignWithSystem - ms;
-
-        LOG1("%s: current %ld (%ld), need wait %ld to trigger", mName.c_str(),
-             curTime.tv_usec / 1000, ms, waitMs);
-        if (waitMs) usleep(waitMs * 1000);
+            waitNs = periodNs - phaseNs;
+
+        LOG1("%s: current phase %ldus, need wait %ldus to trigger", mName.c_str(),
+             phaseNs / 1000, waitNs / 1000);
+        if (waitNs) {
+            int64_t deadlineNs = curNs + waitNs;
+            timespec deadline = {static_cast<time_t>(deadlineNs / 1000000000),
+                                 static_cast<long>(deadlineNs % 1000000000)};
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+            }
+        }
     }
 
     LOG2("%s:Id:%d run pipe start for buffer:%ld", mName.c_str(), mCameraId, inBufSequence);
@@ -655,7 +680,11 @@ int PipeLiteExecutor::processNewFrame() {
         shared_ptr<CameraBuffer> cInBuffer = inBuffers[MAIN_PORT];
         int vc = cInBuffer->getVirtualChannel();
 
-        while ((!SyncManager::getInstance()->vcSynced(vc)) && mThreadRunning) usleep(1);
+        // Sleep until the other vcs catch up, and check the running state every 10ms
+        const int64_t kVcSyncWaitSliceNs = 10000000;
+        while (mThreadRunning &&
+               SyncManager::getInstance()->waitVcSynced(vc, kVcSyncWaitSliceNs) != OK) {
+        }
 
         int seq = cInBuffer->getSequence();
         SyncManager::getInstance()->printVcSyncCount();
@@ -693,11 +722,11 @@ int PipeLiteExecutor::processNewFrame() {
         // For general case, notify frame prior to stats to make sure its consumers can get
         // the frame buffers as early as possible.
         notifyFrameDone(inV4l2Buf, outBuffers);
-        notifyStatsDone(tuningMode, inV4l2Buf, outStatsBuffers, eventType);
+        handleStatsDone(tuningMode, inV4l2Buf, outStatsBuffers, eventType, true);
     } else if (mNotifyPolicy == POLICY_STATS_FIRST) {
         // Notify stats first and then handle frame buffers to make sure the next executor
         // can get this executor's IQ result.
-        notifyStatsDone(tuningMode, inV4l2Buf, outStatsBuffers, eventType);
+        handleStatsDone(tuningMode, inV4l2Buf, outStatsBuffers, eventType, false);
         notifyFrameDone(inV4l2Buf, outBuffers);
     } else {
         LOGW("Invalid notify policy:%d, should never happen.", mNotifyPolicy);
@@ -761,48 +790,82 @@ int PipeLiteExecutor::runPipe(map<Port, shared_ptr<CameraBuffer>>& inBuffers,
 
     outStatsBuffers.clear();
     eventType.clear();
-    int statTotalNum = 0;
-    for (unsigned int pgIndex = 0; pgIndex < mPGExecutors.size(); pgIndex++) {
-        ExecutorUnit& unit = mPGExecutors[pgIndex];
-
-        // Prepare stats buffers for 3A/sis
-        vector<ia_binary_data*> pgStatsDatas;
-        // For 3A stats
-        unsigned int statsCount = unit.statKernelUids.size();
-        for (unsigned int counter = 0; counter < statsCount; counter++) {
-            if (mStatsBuffers.empty()) {
-                LOGW("No available stats buffer.");
-                break;
+    // Prepare stats buffers for 3A/sis of all PGs before any PG is submitted
+    unsigned int pgCount = mPGExecutors.size();
+    vector<ia_binary_data*> pgStatsDatas(pgCount, nullptr);
+    vector<int> sisStatsIndex(pgCount, -1);
+    {
+        // The stats buffers are returned in mStatsDecodeThread too
+        AutoMutex statsLock(mStatsBuffersLock);
+        for (unsigned int pgIndex = 0; pgIndex < pgCount; pgIndex++) {
+            ExecutorUnit& unit = mPGExecutors[pgIndex];
+
+            // For 3A stats
+            unsigned int statsCount = unit.statKernelUids.size();
+            for (unsigned int counter = 0; counter < statsCount; counter++) {
+                if (mStatsBuffers.empty()) {
+                    LOGW("No available stats buffer.");
+                    break;
+                }
+                outStatsBuffers.push_back(mStatsBuffers.front());
+                eventType.push_back(EVENT_PSYS_STATS_BUF_READY);
+                ia_binary_data* buffer = (ia_binary_data*)mStatsBuffers.front()->getBufferAddr();
+                CheckAndLogError(buffer == nullptr, BAD_VALUE, "buffer is null pointer.");
+                buffer->size = 0;
+                // Serialize the stats to the buffer's own memory if it has, otherwise the stats
+                // memory is from p2p
+                buffer->data = nullptr;
+                if (mStatsBuffers.front()->getBufferSize() > kStatsDataOffset) {
+                    buffer->data = reinterpret_cast<uint8_t*>(buffer) + kStatsDataOffset;
+                }
+                // Currently PG handles one stats buffer only
+                if (!pgStatsDatas[pgIndex]) pgStatsDatas[pgIndex] = buffer;
+                mStatsBuffers.pop();
             }
-            outStatsBuffers.push_back(mStatsBuffers.front());
-            eventType.push_back(EVENT_PSYS_STATS_BUF_READY);
-            ia_binary_data* buffer = (ia_binary_data*)mStatsBuffers.front()->getBufferAddr();
-            CheckAndLogError(buffer == nullptr, BAD_VALUE, "buffer is null pointer.");
-            buffer->size = 0;  // Clear it, then the stats memory is from p2p
-            buffer->data = nullptr;
-            pgStatsDatas.push_back(buffer);
-            mStatsBuffers.pop();
-        }
-        unsigned int sisCount = unit.sisKernelUids.size();
-        for (unsigned int counter = 0; counter < sisCount; counter++) {
-            if (mStatsBuffers.empty()) {
-                LOGW("No available stats buffer.");
-                break;
+            unsigned int sisCount = unit.sisKernelUids.size();
+            for (unsigned int counter = 0; counter < sisCount; counter++) {
+                if (mStatsBuffers.empty()) {
+                    LOGW("No available stats buffer.");
+                    break;
+                }
+                // Currently handle one sis output only
+                if (sisStatsIndex[pgIndex] < 0) sisStatsIndex[pgIndex] = outStatsBuffers.size();
+                outStatsBuffers.push_back(mStatsBuffers.front());
+                eventType.push_back(EVENT_PSYS_STATS_SIS_BUF_READY);
+                ia_binary_data* buffer = (ia_binary_data*)mStatsBuffers.front()->getBufferAddr();
+                if (!pgStatsDatas[pgIndex]) pgStatsDatas[pgIndex] = buffer;
+                mStatsBuffers.pop();
             }
-            outStatsBuffers.push_back(mStatsBuffers.front());
-            eventType.push_back(EVENT_PSYS_STATS_SIS_BUF_READY);
-            ia_binary_data* buffer = (ia_binary_data*)mStatsBuffers.front()->getBufferAddr();
-            pgStatsDatas.push_back(buffer);
-            mStatsBuffers.pop();
+        }
+    }
+
+    // Run PGs. The terminals of the next PG are encoded while the current PG is running in
+    // hardware, and the next PG is submitted once the current one (its producer) is done.
+    ExecutorUnit& firstUnit = mPGExecutors.front();
+    // Update sequence only for the 1st input buffer currently
+    firstUnit.inputBuffers.begin()->second->setSequence(sequence);
+    ret = firstUnit.pg->prepareIteration(firstUnit.inputBuffers, firstUnit.outputBuffers,
+                                         ipuParameters);
+    CheckAndLogError((ret != OK), ret, "%s: pipe prepare error %d", mName.c_str(), ret);
+    ret = firstUnit.pg->submitIteration();
+    CheckAndLogError((ret != OK), ret, "%s: pipe submit error %d", mName.c_str(), ret);
+
+    for (unsigned int pgIndex = 0; pgIndex < pgCount; pgIndex++) {
+        ExecutorUnit& unit = mPGExecutors[pgIndex];
+
+        int prepareRet = OK;
+        if (pgIndex + 1 < pgCount) {
+            ExecutorUnit& nextUnit = mPGExecutors[pgIndex + 1];
+            nextUnit.inputBuffers.begin()->second->setSequence(sequence);
+            prepareRet = nextUnit.pg->prepareIteration(nextUnit.inputBuffers,
+                                                       nextUnit.outputBuffers, ipuParameters);
         }
 
-        // Run PGs
-        // Update sequence only for the 1st input buffer currently
-        unit.inputBuffers.begin()->second->setSequence(sequence);
-        // Currently PG handles one stats buffer only
-        ret = unit.pg->iterate(unit.inputBuffers, unit.outputBuffers,
-                               pgStatsDatas.empty() ? nullptr : pgStatsDatas[0], ipuParameters);
+        // Always wait for the running PG, even if the next one failed to prepare
+        ret = unit.pg->completeIteration(pgStatsDatas[pgIndex]);
         CheckAndLogError((ret != OK), ret, "%s: pipe iteration error %d", mName.c_str(), ret);
+        CheckAndLogError((prepareRet != OK), prepareRet, "%s: pipe prepare error %d",
+                         mName.c_str(), prepareRet);
 
         if (CameraDump::isDumpTypeEnable(DUMP_PSYS_INTERM_BUFFER)) {
             for (auto& item : unit.outputBuffers) {
@@ -812,12 +875,14 @@ int PipeLiteExecutor::runPipe(map<Port, shared_ptr<CameraBuffer>>& inBuffers,
                 CameraDump::dumpImage(mCameraId, item.second, M_NA, INVALID_PORT, desc);
             }
         }
-        statTotalNum += statsCount;
-        if (sisCount > 0) {
-            // Currently handle one sis output only
-            handleSisStats(unit.outputBuffers, outStatsBuffers[statTotalNum]);
+        if (sisStatsIndex[pgIndex] >= 0) {
+            handleSisStats(unit.outputBuffers, outStatsBuffers[sisStatsIndex[pgIndex]]);
+        }
+
+        if (pgIndex + 1 < pgCount) {
+            ret = mPGExecutors[pgIndex + 1].pg->submitIteration();
+            CheckAndLogError((ret != OK), ret, "%s: pipe submit error %d", mName.c_str(), ret);
         }
-        statTotalNum += sisCount;
     }
 
     return OK;
@@ -961,6 +1026,139 @@ int PipeLiteExecutor::notifyStatsDone(TuningMode tuningMode, const v4l2_buffer_t
     return OK;
 }
 
+int PipeLiteExecutor::handleStatsDone(TuningMode tuningMode, const v4l2_buffer_t& inV4l2Buf,
+                                      const vector<shared_ptr<CameraBuffer>>& outStatsBuffers,
+                                      const vector<EventType>& eventType, bool async) {
+    if (!mStatsDecodeThread) {
+        AutoMutex l(mStatsNotifyLock);
+        return notifyStatsDone(tuningMode, inV4l2Buf, outStatsBuffers, eventType);
+    }
+
+    std::deque<StatsDecodeJob> droppedJobs;
+    auto releaseDroppedJobs = [&]() {
+        for (auto& job : droppedJobs) {
+            LOG2("<seq%u> drop the stale stats of executor %s", job.inV4l2Buf.sequence,
+                 mName.c_str());
+            for (auto& statsBuf : job.statsBuffers) {
+                if (statsBuf) releaseStatsBuffer(statsBuf);
+            }
+        }
+        droppedJobs.clear();
+    };
+    if (async) {
+        {
+            // Queue the stats done event even if there is no stats output, to keep the order
+            AutoMutex l(mStatsDecodeLock);
+            // Only the latest stats are used by 3A, drop the older ones if 3A is behind
+            while (mStatsDecodeQueue.size() >= kMaxStatsDecodeQueueSize) {
+                droppedJobs.push_back(std::move(mStatsDecodeQueue.front()));
+                mStatsDecodeQueue.pop_front();
+                mStatsDropCount++;
+            }
+            StatsDecodeJob job = {tuningMode, inV4l2Buf, outStatsBuffers, eventType,
+                                  CameraUtils::systemTime()};
+            mStatsDecodeQueue.push_back(std::move(job));
+            mStatsDecodeSignal.signal();
+        }
+        releaseDroppedJobs();
+        return OK;
+    }
+
+    /*
+     * The stats are notified now, drop the queued ones since they are older. mStatsNotifyLock
+     * is held before the queue is checked, so the stats being decoded in mStatsDecodeThread
+     * are notified first, and the stats done events of the dropped ones are still sent in
+     * the frame order.
+     */
+    AutoMutex l(mStatsNotifyLock);
+    {
+        AutoMutex queueLock(mStatsDecodeLock);
+        mStatsDropCount += mStatsDecodeQueue.size();
+        droppedJobs.swap(mStatsDecodeQueue);
+    }
+    for (auto& job : droppedJobs) mPSysDag->onStatsDone(job.inV4l2Buf.sequence);
+    releaseDroppedJobs();
+
+    return notifyStatsDone(tuningMode, inV4l2Buf, outStatsBuffers, eventType);
+}
+
+bool PipeLiteExecutor::decodeQueuedStats() {
+    {
+        ConditionLock lock(mStatsDecodeLock);
+        while (mStatsDecodeQueue.empty() && !mStatsDecodeExit) {
+            mStatsDecodeSignal.wait(lock);
+        }
+        if (mStatsDecodeExit) return false;
+    }
+
+    // Take the job with mStatsNotifyLock held, see handleStatsDone()
+    AutoMutex l(mStatsNotifyLock);
+    StatsDecodeJob job;
+    {
+        AutoMutex queueLock(mStatsDecodeLock);
+        // The queue may be dropped by handleStatsDone() in the meantime
+        if (mStatsDecodeQueue.empty()) return true;
+
+        job = std::move(mStatsDecodeQueue.front());
+        mStatsDecodeQueue.pop_front();
+    }
+
+    notifyStatsDone(job.tuningMode, job.inV4l2Buf, job.statsBuffers, job.eventType);
+
+    nsecs_t latency = CameraUtils::systemTime() - job.queuedTime;
+    LOG2("<seq%u> %s: stats decoded in %ld us", job.inV4l2Buf.sequence, __func__,
+         latency / 1000);
+
+    AutoMutex queueLock(mStatsDecodeLock);
+    mStatsDecodeCount++;
+    mStatsDecodeTotalLatency += latency;
+    mStatsDecodeMaxLatency = std::max(mStatsDecodeMaxLatency, latency);
+    return true;
+}
+
+void PipeLiteExecutor::startStatsDecodeThread() {
+    // Decode in the executor thread if the stats are decoded at 3A running (running rate
+    // supported), or if the stats memory is required to be shared with the sandbox.
+    bool asyncDecode = mStreamId == VIDEO_STREAM_ID && mkernelsCountWithStats > 0 &&
+                       !PlatformData::isStatsRunningRateSupport(mCameraId);
+#ifdef ENABLE_SANDBOXING
+    asyncDecode = false;
+#endif
+    if (!asyncDecode) return;
+
+    {
+        AutoMutex l(mStatsDecodeLock);
+        mStatsDecodeExit = false;
+        mStatsDecodeCount = 0;
+        mStatsDropCount = 0;
+        mStatsDecodeTotalLatency = 0;
+        mStatsDecodeMaxLatency = 0;
+    }
+
+    mStatsDecodeThread = std::unique_ptr<StatsDecodeThread>(new StatsDecodeThread(this));
+    mStatsDecodeThread->run("StatsDecode", PRIORITY_NORMAL);
+}
+
+void PipeLiteExecutor::stopStatsDecodeThread() {
+    if (!mStatsDecodeThread) return;
+
+    {
+        AutoMutex l(mStatsDecodeLock);
+        mStatsDecodeExit = true;
+        mStatsDecodeSignal.signal();
+    }
+    mStatsDecodeThread->join();
+    mStatsDecodeThread.reset();
+
+    AutoMutex l(mStatsDecodeLock);
+    mStatsDropCount += mStatsDecodeQueue.size();
+    mStatsDecodeQueue.clear();
+    LOG1("%s executor:%s, stats decoded: %ld, dropped: %ld, latency avg: %ld us, max: %ld us",
+         __func__, mName.c_str(), mStatsDecodeCount, mStatsDropCount,
+         mStatsDecodeCount ? mStatsDecodeTotalLatency / mStatsDecodeCount / 1000 : 0,
+         mStatsDecodeMaxLatency / 1000);
+}
+
 int PipeLiteExecutor::allocBuffers() {
     LOG1("%s executor:%s", __func__, mName.c_str());
 
@@ -1003,6 +1201,17 @@ int PipeLiteExecutor::allocBuffers() {
     }
 
     int bufCount = PlatformData::getMaxRequestsInflight(mCameraId);
+    // The p2p stats memory is overwritten by the next run, so the stats decoded in
+    // mStatsDecodeThread are serialized to the memory of the stats buffers, which are
+    // shared by all PGs.
+    unsigned int statsBufferSize = sizeof(ia_binary_data);
+    if (mStatsDecodeThread) {
+        uint32_t maxStatsSize = 0;
+        for (auto& unit : mPGExecutors) {
+            maxStatsSize = std::max(maxStatsSize, unit.pg->getMaxStatsSize());
+        }
+        if (maxStatsSize > 0) statsBufferSize = kStatsDataOffset + PAGE_ALIGN(maxStatsSize);
+    }
     for (auto& unit : mPGExecutors) {
         // Assign internal buffers for terminals of PGs according to connection
         for (auto& terminal : unit.inputTerminals) {
@@ -1023,7 +1232,7 @@ int PipeLiteExecutor::allocBuffers() {
         }
         for (unsigned int i = 0; i < bufCount * statsBufferCount; i++) {
             shared_ptr<CameraBuffer> statsBuf = CameraBuffer::create(
-                mCameraId, BUFFER_USAGE_PSYS_STATS, V4L2_MEMORY_USERPTR, sizeof(ia_binary_data), i);
+                mCameraId, BUFFER_USAGE_PSYS_STATS, V4L2_MEMORY_USERPTR, statsBufferSize, i);
             CheckAndLogError(!statsBuf, NO_MEMORY, "Executor %s: Allocate stats buffer failed",
                              mName.c_str());
             ia_binary_data* buffer = (ia_binary_data*)statsBuf->getBufferAddr();
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <deque>
 #include <map>
 #include <memory>
 #include <string>
@@ -151,6 +152,17 @@ class PipeLiteExecutor : public BufferQueue, public ISchedulerNode {
     int notifyStatsDone(TuningMode tuningMode, const v4l2_buffer_t& inV4l2Buf,
                         const std::vector<std::shared_ptr<CameraBuffer>>& outStatsBuffers,
                         const std::vector<EventType>& eventType);
+    /**
+     * Queue the stats to mStatsDecodeThread if async is true and the thread is running,
+     * otherwise drop the queued stats (they are older, only their stats done events are sent)
+     * and notify the stats done directly. The stats done events are kept in the frame order.
+     */
+    int handleStatsDone(TuningMode tuningMode, const v4l2_buffer_t& inV4l2Buf,
+                        const std::vector<std::shared_ptr<CameraBuffer>>& outStatsBuffers,
+                        const std::vector<EventType>& eventType, bool async);
+    bool decodeQueuedStats();
+    void startStatsDecodeThread();
+    void stopStatsDecodeThread();
 
     int createPGs();
     int allocBuffers();
@@ -198,6 +210,43 @@ class PipeLiteExecutor : public BufferQueue, public ISchedulerNode {
     int64_t mLastStatsSequence;
     CameraBufQ mStatsBuffers;
     Mutex mStatsBuffersLock;
+
+    /*
+     * Decode the 3A stats and notify them in mStatsDecodeThread, so that the executor doesn't
+     * wait for the decoding. Each stats buffer owns the page aligned memory the stats are
+     * serialized to, which is kept until the stats are decoded.
+     */
+    class StatsDecodeThread : public Thread {
+     public:
+        explicit StatsDecodeThread(PipeLiteExecutor* executor) : mExecutor(executor) {}
+        virtual bool threadLoop() { return mExecutor->decodeQueuedStats(); }
+
+     private:
+        PipeLiteExecutor* mExecutor;
+    };
+
+    struct StatsDecodeJob {
+        TuningMode tuningMode;
+        v4l2_buffer_t inV4l2Buf;
+        std::vector<std::shared_ptr<CameraBuffer>> statsBuffers;
+        std::vector<EventType> eventType;
+        nsecs_t queuedTime;
+    };
+
+    // Only the latest stats are used by 3A, the older ones are dropped if the queue is full
+    static const size_t kMaxStatsDecodeQueueSize = 2;
+    std::unique_ptr<StatsDecodeThread> mStatsDecodeThread;
+    Mutex mStatsDecodeLock;  // Guard the queue and the counters below
+    Condition mStatsDecodeSignal;
+    std::deque<StatsDecodeJob> mStatsDecodeQueue;
+    bool mStatsDecodeExit;
+    int64_t mStatsDecodeCount;
+    int64_t mStatsDropCount;
+    nsecs_t mStatsDecodeTotalLatency;
+    nsecs_t mStatsDecodeMaxLatency;
+    // Serialize notifyStatsDone() between the executor thread and mStatsDecodeThread, held
+    // before mStatsDecodeLock when both are needed
+    Mutex mStatsNotifyLock;
     std::vector<std::string> mExclusivePGs;
     PSysDAG* mPSysDag;
 
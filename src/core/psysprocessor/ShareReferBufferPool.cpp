@@ -23,6 +23,7 @@
 #include "iutils/Errors.h"
 
 using std::map;
+using std::shared_ptr;
 using std::unique_ptr;
 using std::vector;
 
@@ -36,11 +37,8 @@ int64_t ShareReferBufferPool::constructReferId(int32_t streamId, int32_t pgId, i
 
 ShareReferBufferPool::~ShareReferBufferPool() {
     AutoMutex l(mPairLock);
-    while (!mUserPairs.empty()) {
-        UserPair* pair = mUserPairs.back();
-        mUserPairs.pop_back();
-        delete pair;
-    }
+    mPairMap.clear();
+    mUserPairs.clear();
 }
 
 int32_t ShareReferBufferPool::setReferPair(const std::string& producerPgName, int64_t producerId,
@@ -48,7 +46,7 @@ int32_t ShareReferBufferPool::setReferPair(const std::string& producerPgName, in
     CheckAndLogError(producerId == consumerId, BAD_VALUE, "same pair for producer/consumer %lx",
                      producerId);
 
-    UserPair* pair = new UserPair;
+    shared_ptr<UserPair> pair = std::make_shared<UserPair>();
     pair->producerPgName = producerPgName;
     pair->producerId = producerId;
     pair->consumerPgName = consumerPgName;
@@ -59,25 +57,26 @@ int32_t ShareReferBufferPool::setReferPair(const std::string& producerPgName, in
          consumerPgName.c_str(), consumerId);
     AutoMutex l(mPairLock);
     mUserPairs.push_back(pair);
+    mPairMap[producerId] = pair;
+    mPairMap[consumerId] = pair;
     return OK;
 }
 
 int32_t ShareReferBufferPool::clearReferPair(int64_t id) {
     AutoMutex l(mPairLock);
     for (auto it = mUserPairs.begin(); it != mUserPairs.end(); it++) {
-        UserPair* pair = *it;
+        shared_ptr<UserPair> pair = *it;
         if (pair->producerId != id && pair->consumerId != id) continue;
 
-        pair->bufferLock.lock();
+        AutoMutex m(pair->bufferLock);
         if (pair->busy) {
-            pair->bufferLock.unlock();
             LOGE("Can't clear pair %lx because Q is busy!", id);
             return UNKNOWN_ERROR;
         }
 
         mUserPairs.erase(it);
-        pair->bufferLock.unlock();
-        delete pair;
+        mPairMap.erase(pair->producerId);
+        mPairMap.erase(pair->consumerId);
         return OK;
     }
 
@@ -86,7 +85,7 @@ int32_t ShareReferBufferPool::clearReferPair(int64_t id) {
 
 int32_t ShareReferBufferPool::getMinBufferNum(int64_t id) {
     AutoMutex l(mPairLock);
-    for (auto pair : mUserPairs) {
+    for (const auto& pair : mUserPairs) {
         if (pair->producerId == id)
             return PlatformData::getMaxRawDataNum(mCameraId);
         else if (pair->consumerId == id)
@@ -98,15 +97,13 @@ int32_t ShareReferBufferPool::getMinBufferNum(int64_t id) {
 int32_t ShareReferBufferPool::registerReferBuffers(int64_t id, CIPR::Buffer* buffer) {
     CheckAndLogError(!buffer, BAD_VALUE, "%s, buffer is nullptr", __func__);
 
-    AutoMutex l(mPairLock);
-    UserPair* pair = findUserPair(id);
+    shared_ptr<UserPair> pair = findUserPair(id);
     CheckAndLogError(!pair, UNKNOWN_ERROR, "Can't find id %lx", id);
 
     ReferBuffer referBuf = {-1, buffer};
     AutoMutex m(pair->bufferLock);
-    std::vector<ReferBuffer>& bufV =
-        (id == pair->producerId) ? pair->mProducerBuffers : pair->mConsumerBuffers;
-    bufV.push_back(referBuf);
+    ReferRing& bufV = (id == pair->producerId) ? pair->mProducerBuffers : pair->mConsumerBuffers;
+    bufV.add(referBuf);
 
     if (pair->active && !pair->mProducerBuffers.empty() && !pair->mConsumerBuffers.empty()) {
         int32_t srcSize = 0, dstSize = 0;
@@ -136,19 +133,16 @@ int32_t ShareReferBufferPool::acquireBuffer(int64_t id, CIPR::Buffer** referIn,
     CheckAndLogError(!referIn || !referOut, BAD_VALUE, "nullptr input for refer buf pair");
 
     int64_t inSequence = outSequence - 1;
-    UserPair* pair = nullptr;
+    shared_ptr<UserPair> pair = findUserPair(id);
+    CheckAndLogError(!pair, UNKNOWN_ERROR, "Can't find id %lx", id);
     {
-        AutoMutex l(mPairLock);
-        pair = findUserPair(id);
-        CheckAndLogError(!pair, UNKNOWN_ERROR, "Can't find id %lx", id);
-
         AutoMutex m(pair->bufferLock);
-        std::vector<ReferBuffer>& bufV =
+        ReferRing& bufV =
             (id == pair->producerId) ? pair->mProducerBuffers : pair->mConsumerBuffers;
-        CheckAndLogError(bufV.empty(), BAD_VALUE, "no refer buffer for id %lx", id);
+        CheckAndLogError(bufV.size() < 2, BAD_VALUE, "no enough refer buffer for id %lx", id);
 
         *referOut = bufV.front().buffer;
-        bufV.erase(bufV.begin());  // pop front (the oldest one) as new output
+        bufV.popFront();  // pop front (the oldest one) as new output
         *referIn = bufV.back().buffer;
         if (bufV.back().sequence == inSequence || inSequence < 0) {
             // Return if found required buffers or it is the 1st frame.
@@ -158,12 +152,11 @@ int32_t ShareReferBufferPool::acquireBuffer(int64_t id, CIPR::Buffer** referIn,
         } else if (id == pair->producerId) {
             // Find required refer in buffer for producer.
             // In general, it happens in reprocessing case that producer want to run old frame
-            for (auto& item : bufV) {
-                if (item.sequence == inSequence) {
-                    *referIn = item.buffer;
-                    LOG2("%lx acquire in seq %ld for reprocessing", id, inSequence);
-                    return OK;
-                }
+            int index = bufV.findLatest(inSequence);
+            if (index >= 0 && bufV.at(index).sequence == inSequence) {
+                *referIn = bufV.at(index).buffer;
+                LOG2("%lx acquire in seq %ld for reprocessing", id, inSequence);
+                return OK;
             }
             LOG1("%lx has no refer in seq %ld", id, inSequence);
             return UNKNOWN_ERROR;
@@ -180,7 +173,7 @@ int32_t ShareReferBufferPool::acquireBuffer(int64_t id, CIPR::Buffer** referIn,
     int waitFrames = 3;  // wait 3 frames
     while (waitFrames-- && ret == NOT_ENOUGH_DATA) {
         ConditionLock lock(pair->bufferLock);
-        ret = findReferBuffer(&pair->mProducerBuffers, inSequence, &srcBuf);
+        ret = findReferBuffer(pair->mProducerBuffers, inSequence, &srcBuf);
 
         if (ret == NOT_ENOUGH_DATA) {
             pair->bufferSignal.waitRelative(lock, kWaitDuration * SLOWLY_MULTIPLIER);
@@ -212,52 +205,107 @@ int32_t ShareReferBufferPool::releaseBuffer(int64_t id, CIPR::Buffer* referIn,
                                             CIPR::Buffer* referOut, int64_t outSequence) {
     CheckAndLogError(!referIn || !referOut, BAD_VALUE, "nullptr for refer buf pair for release");
 
-    AutoMutex l(mPairLock);
-    UserPair* pair = findUserPair(id);
+    shared_ptr<UserPair> pair = findUserPair(id);
     CheckAndLogError(!pair, UNKNOWN_ERROR, "Can't find id %lx", id);
 
     AutoMutex m(pair->bufferLock);
-    std::vector<ReferBuffer>& bufV =
-        (id == pair->producerId) ? pair->mProducerBuffers : pair->mConsumerBuffers;
-    if (outSequence < bufV.back().sequence) {
+    ReferRing& bufV = (id == pair->producerId) ? pair->mProducerBuffers : pair->mConsumerBuffers;
+    int ret = OK;
+    if (!bufV.empty() && outSequence < bufV.back().sequence) {
         // Drop old data (in reprocessing case)
         ReferBuffer referBuf = {-1, referOut};
-        bufV.insert(bufV.begin(), referBuf);
+        ret = bufV.pushFront(referBuf);
     } else {
         ReferBuffer referBuf = {outSequence, referOut};
-        bufV.push_back(referBuf);
+        ret = bufV.pushBack(referBuf);
     }
+    CheckAndLogError(ret != OK, ret, "%lx release out seq %ld without acquiring", id,
+                     outSequence);
     pair->bufferSignal.signal();
 
     return OK;
 }
 
-ShareReferBufferPool::UserPair* ShareReferBufferPool::findUserPair(int64_t id) {
-    for (auto pair : mUserPairs) {
-        if (pair->consumerId == id || pair->producerId == id) {
-            return pair;
-        }
-    }
-    return nullptr;
+shared_ptr<ShareReferBufferPool::UserPair> ShareReferBufferPool::findUserPair(int64_t id) {
+    // The lock is held for the lookup only, the caller keeps the pair alive with its reference
+    AutoMutex l(mPairLock);
+    auto it = mPairMap.find(id);
+    return (it != mPairMap.end()) ? it->second : nullptr;
 }
 
-int ShareReferBufferPool::findReferBuffer(std::vector<ReferBuffer>* bufV, int64_t sequence,
+int ShareReferBufferPool::findReferBuffer(const ReferRing& bufV, int64_t sequence,
                                           CIPR::Buffer** out) {
-    CheckAndLogError(!bufV, BAD_VALUE, "nullptr buffers");
     CheckAndLogError(!out, BAD_VALUE, "nullptr out buffer");
 
-    if (bufV->empty() || bufV->back().sequence < sequence) return NOT_ENOUGH_DATA;
+    if (bufV.empty() || bufV.back().sequence < sequence) return NOT_ENOUGH_DATA;
 
-    for (auto item = bufV->rbegin(); item != bufV->rend(); item++) {
-        if (item->sequence <= sequence) {
-            *out = item->buffer;
-            LOG2("%s: find seq %ld for required seq %ld", __func__, item->sequence, sequence);
-            return OK;
-        }
+    int index = bufV.findLatest(sequence);
+    if (index >= 0) {
+        *out = bufV.at(index).buffer;
+        LOG2("%s: find seq %ld for required seq %ld", __func__, bufV.at(index).sequence,
+             sequence);
+        return OK;
     }
 
     LOGE("No refer buffer with required seq %ld", sequence);
     return UNKNOWN_ERROR;
 }
 
+void ShareReferBufferPool::ReferRing::add(const ReferBuffer& buf) {
+    // Only called when registering buffers, grow the ring and restart it from slot 0
+    std::vector<ReferBuffer> slots;
+    slots.reserve(mSlots.size() + 1);
+    for (size_t i = 0; i < mCount; i++) {
+        slots.push_back(at(i));
+    }
+    slots.push_back(buf);
+    mCount = slots.size();
+    slots.resize(mSlots.size() + 1);
+    mSlots.swap(slots);
+    mHead = 0;
+}
+
+void ShareReferBufferPool::ReferRing::popFront() {
+    if (mCount == 0) return;
+
+    mHead = (mHead + 1) % mSlots.size();
+    mCount--;
+}
+
+int ShareReferBufferPool::ReferRing::pushFront(const ReferBuffer& buf) {
+    CheckAndLogError(mCount >= mSlots.size(), INVALID_OPERATION, "refer ring is full");
+
+    mHead = (mHead + mSlots.size() - 1) % mSlots.size();
+    mSlots[mHead] = buf;
+    mCount++;
+    return OK;
+}
+
+int ShareReferBufferPool::ReferRing::pushBack(const ReferBuffer& buf) {
+    CheckAndLogError(mCount >= mSlots.size(), INVALID_OPERATION, "refer ring is full");
+
+    mSlots[(mHead + mCount) % mSlots.size()] = buf;
+    mCount++;
+    return OK;
+}
+
+int ShareReferBufferPool::ReferRing::findLatest(int64_t sequence) const {
+    if (mCount == 0) return -1;
+
+    // The sequences are continuous in general, so check the slot at the distance from back first.
+    int64_t distance = back().sequence - sequence;
+    if (distance >= 0 && distance < static_cast<int64_t>(mCount)) {
+        size_t index = mCount - 1 - distance;
+        if (at(index).sequence <= sequence &&
+            (index == mCount - 1 || at(index + 1).sequence > sequence)) {
+            return index;
+        }
+    }
+
+    for (int i = mCount - 1; i >= 0; i--) {
+        if (at(i).sequence <= sequence) return i;
+    }
+    return -1;
+}
+
 }  // namespace icamera
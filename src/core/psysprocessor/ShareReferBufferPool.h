@@ -16,7 +16,9 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "iutils/Thread.h"
@@ -70,6 +72,37 @@ class ShareReferBufferPool {
         }
     };
 
+    /**
+     * Fixed size ring of refer buffers, sorted by sequence in ascending order from front to
+     * back. The capacity is the number of registered buffers, so there is no memory move or
+     * allocation when the buffers are acquired and released per frame.
+     */
+    class ReferRing {
+     public:
+        ReferRing() : mHead(0), mCount(0) {}
+
+        void add(const ReferBuffer& buf);
+        bool empty() const { return mCount == 0; }
+        size_t size() const { return mCount; }
+        const ReferBuffer& at(size_t index) const {
+            return mSlots[(mHead + index) % mSlots.size()];
+        }
+        const ReferBuffer& front() const { return at(0); }
+        const ReferBuffer& back() const { return at(mCount - 1); }
+        void popFront();
+        // Return INVALID_OPERATION if the ring is full, which means more buffers are released
+        // than acquired
+        int pushFront(const ReferBuffer& buf);
+        int pushBack(const ReferBuffer& buf);
+        // Find the latest buffer whose sequence isn't later than the given one, -1 if none.
+        int findLatest(int64_t sequence) const;
+
+     private:
+        std::vector<ReferBuffer> mSlots;
+        size_t mHead;
+        size_t mCount;
+    };
+
     struct UserPair {
         std::string producerPgName;  // for debug
         std::string consumerPgName;
@@ -81,21 +114,24 @@ class ShareReferBufferPool {
         Condition bufferSignal;
         bool busy;
 
-        // Sort sequence in ascending order
-        std::vector<ReferBuffer> mProducerBuffers;
-        std::vector<ReferBuffer> mConsumerBuffers;
+        ReferRing mProducerBuffers;
+        ReferRing mConsumerBuffers;
     };
 
  private:
-    UserPair* findUserPair(int64_t id);
-    int findReferBuffer(std::vector<ReferBuffer>* bufV, int64_t sequence, CIPR::Buffer** out);
+    std::shared_ptr<UserPair> findUserPair(int64_t id);
+    int findReferBuffer(const ReferRing& bufV, int64_t sequence, CIPR::Buffer** out);
 
  private:
     static const nsecs_t kWaitDuration = 33000000;  // 33ms
 
     int32_t mCameraId;
     Mutex mPairLock;
-    std::vector<UserPair*> mUserPairs;
+    /* The pairs are shared with the callers which found them, so a pair cleared meanwhile is
+     * only freed when they are done with it */
+    std::vector<std::shared_ptr<UserPair>> mUserPairs;
+    // Both producer and consumer id map to their pair, resolved when the pair is set
+    std::unordered_map<int64_t, std::shared_ptr<UserPair>> mPairMap;
 
  private:
     DISALLOW_COPY_AND_ASSIGN(ShareReferBufferPool);
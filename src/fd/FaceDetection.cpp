@@ -29,6 +29,7 @@
 
 namespace icamera {
 #define FPS_FD_COUNT 60  // the face detection interval to print fps
+#define FD_LATENCY_SMOOTH_FACTOR 4  // new sample weight is 1/4 when smoothing latency
 
 std::unordered_map<int, FaceDetection*> FaceDetection::sInstances;
 Mutex FaceDetection::sLock;
@@ -84,7 +85,11 @@ FaceDetection::FaceDetection(int cameraId, unsigned int maxFaceNum, int32_t halS
           mFDRunIntervalNoFace(icamera::PlatformData::faceEngineRunningIntervalNoFace(cameraId)),
           mFDRunInterval(icamera::PlatformData::faceEngineRunningInterval(cameraId)),
           mFrameCnt(0),
-          mRunCount(0) {
+          mNoFaceCnt(0),
+          mRunCount(0),
+          mLastFrameTime(0),
+          mFrameDuration(0),
+          mFDRunLatency(0) {
     LOG1("<id%d> default interval:%d, interval no face:%d, run interval:%d", cameraId,
          mFDRunDefaultInterval, mFDRunIntervalNoFace, mFDRunInterval);
     initRatioInfo(&mRatioInfo);
@@ -97,11 +102,35 @@ FaceDetection::~FaceDetection() {
 bool FaceDetection::faceRunningByCondition() {
     CheckAndLogError(mInitialized == false, false, "mInitialized is false");
 
+    nsecs_t curTime = CameraUtils::systemTime();
+    if (mLastFrameTime > 0) {
+        nsecs_t duration = curTime - mLastFrameTime;
+        if (mFrameDuration == 0) {
+            mFrameDuration = duration;
+        } else {
+            mFrameDuration += (duration - mFrameDuration) / FD_LATENCY_SMOOTH_FACTOR;
+        }
+    }
+    mLastFrameTime = curTime;
+
+    /*
+     * The detector must finish one frame before the next one is handed over,
+     * otherwise the pending frames back up into the preview path. So never run
+     * FD more often than the measured detector latency allows.
+     */
+    unsigned int latencyInterval = 1;
+    nsecs_t latency = mFDRunLatency.load(std::memory_order_relaxed);
+    if (mFrameDuration > 0 && latency > mFrameDuration) {
+        latencyInterval =
+            static_cast<unsigned int>((latency + mFrameDuration - 1) / mFrameDuration);
+    }
+    unsigned int runInterval = std::max(mFDRunInterval, latencyInterval);
+
     /*
-     * FD runs 1 frame every mFDRunInterval frames.
+     * FD runs 1 frame every runInterval frames.
      * And the default value of mFDRunInterval is mFDRunDefaultInterval
      */
-    if (mFrameCnt % mFDRunInterval == 0) {
+    if (mFrameCnt % runInterval == 0) {
         ++mFrameCnt;
         return true;
     }
@@ -111,7 +140,6 @@ bool FaceDetection::faceRunningByCondition() {
      * we may change FD running's interval frames.
      */
     if (mFDRunIntervalNoFace > mFDRunDefaultInterval) {
-        static unsigned int noFaceCnt = 0;
         int faceNum = getFaceNum();
 
         /*
@@ -120,8 +148,8 @@ bool FaceDetection::faceRunningByCondition() {
          */
         if (faceNum == 0) {
             if (mFDRunInterval != mFDRunIntervalNoFace) {
-                noFaceCnt = ++noFaceCnt % mFDRunIntervalNoFace;
-                if (noFaceCnt == 0) {
+                mNoFaceCnt = (mNoFaceCnt + 1) % mFDRunIntervalNoFace;
+                if (mNoFaceCnt == 0) {
                     mFDRunInterval = mFDRunIntervalNoFace;
                 }
             }
@@ -129,17 +157,27 @@ bool FaceDetection::faceRunningByCondition() {
             if (mFDRunInterval != mFDRunDefaultInterval) {
                 mFDRunInterval = mFDRunDefaultInterval;
                 mFrameCnt = mFDRunInterval - 1;
-                noFaceCnt = 0;
+                mNoFaceCnt = 0;
             }
         }
 
         LOG2("Running face detection for every %d frames, faceNum %d", mFDRunInterval, faceNum);
     }
 
-    mFrameCnt = ++mFrameCnt % mFDRunInterval;
+    runInterval = std::max(mFDRunInterval, latencyInterval);
+    LOG2("@%s, run interval %u, detect latency %ldus, frame duration %ldus", __func__,
+         runInterval, latency / 1000, mFrameDuration / 1000);
+    mFrameCnt = (mFrameCnt + 1) % runInterval;
     return false;
 }
 
+void FaceDetection::updateFDRunLatency(nsecs_t latency) {
+    nsecs_t smoothed = mFDRunLatency.load(std::memory_order_relaxed);
+    smoothed = (smoothed == 0) ? latency
+                               : smoothed + (latency - smoothed) / FD_LATENCY_SMOOTH_FACTOR;
+    mFDRunLatency.store(smoothed, std::memory_order_relaxed);
+}
+
 void FaceDetection::printfFDRunRate() {
     if (!Log::isLogTagEnabled(ST_FPS, CAMERA_DEBUG_LOG_LEVEL2)) return;
 
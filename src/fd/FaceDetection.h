@@ -23,6 +23,7 @@
 
 #include <ia_types.h>
 
+#include <atomic>
 #include <memory>
 #include <queue>
 #include <unordered_map>
@@ -72,6 +73,11 @@ class FaceDetection : public Thread {
 
  protected:
     void printfFDRunRate();
+    /**
+     * Feed the measured detector latency back to the run interval scheduler,
+     * so that FD never gets more frames than it can process in time.
+     */
+    void updateFDRunLatency(nsecs_t latency);
     virtual int getFaceNum() { return 0; }
     virtual void getResultFor3A(cca::cca_face_state* faceState) = 0;
     virtual void getResultForApp(CVFaceDetectionAbstractResult* result) = 0;
@@ -110,7 +116,12 @@ class FaceDetection : public Thread {
     unsigned int mFDRunIntervalNoFace;   // FD running's interval frames without face.
     unsigned int mFDRunInterval;         // run 1 frame every mFDRunInterval frames.
     unsigned int mFrameCnt;  // from 0 to (mFDRunInterval - 1).
+    unsigned int mNoFaceCnt;
     unsigned int mRunCount;
+
+    nsecs_t mLastFrameTime;
+    nsecs_t mFrameDuration;              // Smoothed interval between preview frames.
+    std::atomic<nsecs_t> mFDRunLatency;  // Smoothed detector latency, updated by FD thread.
     timeval mRequestRunTime;
 };
 #else
@@ -33,7 +33,8 @@ namespace icamera {
 
 FaceSSD::FaceSSD(int cameraId, unsigned int maxFaceNum, int32_t halStreamId, int width, int height,
                  int gfxFmt, int usage)
-        : FaceDetection(cameraId, maxFaceNum, halStreamId, width, height) {
+        : FaceDetection(cameraId, maxFaceNum, halStreamId, width, height),
+          mDetectStartTime(0) {
     CLEAR(mResult);
 
     mFaceDetector = cros::FaceDetector::Create();
@@ -48,6 +49,10 @@ FaceSSD::~FaceSSD() {
 
 void FaceSSD::faceDetectResult(cros::FaceDetectResult ret,
                                std::vector<human_sensing::CrosFace> faces) {
+    if (mDetectStartTime > 0) {
+        updateFDRunLatency(CameraUtils::systemTime() - mDetectStartTime);
+    }
+
     AutoMutex l(mFaceResultLock);
     CLEAR(mResult);
 
@@ -125,6 +130,7 @@ void FaceSSD::runFaceDetectionBySync(const std::shared_ptr<camera3::Camera3Buffe
     cros::Size input_size = cros::Size(ccBuf->width(), ccBuf->height());
     const uint8_t* buffer_addr = static_cast<uint8_t*>(ccBuf->data());
 
+    mDetectStartTime = CameraUtils::systemTime();
     // base::Unretained is safe since 'this' joins 'face thread' in the destructor.
     mFaceDetector->DetectAsync(buffer_addr, input_stride, input_size, std::nullopt,
                                base::BindOnce(&FaceSSD::faceDetectResult, base::Unretained(this)));
@@ -49,6 +49,7 @@ class FaceSSD : public FaceDetection {
 
     std::unique_ptr<cros::FaceDetector> mFaceDetector;
     FaceSSDResult mResult;
+    std::atomic<nsecs_t> mDetectStartTime;
     DISALLOW_COPY_AND_ASSIGN(FaceSSD);
 };
 
@@ -129,9 +129,10 @@ void FaceDetectionPVL::runFaceDetectionBySync(
     int ret = mFace->run(params, sizeof(FaceDetectionRunParams), buffer.addr);
 #endif
 
+    nsecs_t latency = CameraUtils::systemTime() - startTime;
+    updateFDRunLatency(latency);
     printfFDRunRate();
-    LOG2("@%s: ret:%d, mFace runs %ums", __func__, ret,
-         (unsigned)((CameraUtils::systemTime() - startTime) / 1000000));
+    LOG2("@%s: ret:%d, mFace runs %ums", __func__, ret, (unsigned)(latency / 1000000));
 
     {
         AutoMutex l(mFaceResultLock);
@@ -153,28 +154,54 @@ void FaceDetectionPVL::runFaceDetectionByAsync(
     CheckAndLogError(mInitialized == false, VOID_VALUE, "@%s, mInitialized is false", __func__);
 
     const icamera::camera_buffer_t buffer = ccBuf->getHalBuffer();
-    int size = buffer.s.stride * buffer.s.height;
-    CheckAndLogError(size > MAX_FACE_FRAME_SIZE_ASYNC, VOID_VALUE,
-                     "face frame buffer is too small!, w:%d,h:%d,size:%d", buffer.s.width,
-                     buffer.s.height, size);
+    int width = buffer.s.width;
+    int height = buffer.s.height;
+    int stride = buffer.s.stride;
+    int size = width * height;
+    CheckAndLogError(size > MAX_FACE_FRAME_SIZE_ASYNC || width > stride, VOID_VALUE,
+                     "face frame buffer is too small!, w:%d,h:%d,s:%d", width, height, stride);
 
     FaceDetectionRunParams* params = acquireRunBuf();
     CheckAndLogError(!params, VOID_VALUE, "Fail to acquire face engine buffer");
 
+    // Only the Y plane is used, pack it without the stride padding.
+    const uint8_t* src = static_cast<const uint8_t*>(buffer.addr);
+    if (stride == width) {
+        MEMCPY_S(params->data, MAX_FACE_FRAME_SIZE_ASYNC, src, size);
+    } else {
+        uint8_t* dst = params->data;
+        for (int i = 0; i < height; i++) {
+            MEMCPY_S(dst, width, src, width);
+            dst += width;
+            src += stride;
+        }
+    }
     params->size = size;
-    MEMCPY_S(params->data, MAX_FACE_FRAME_SIZE_ASYNC, buffer.addr, size);
-    params->width = buffer.s.width;
-    params->height = buffer.s.height;
+    params->width = width;
+    params->height = height;
     /* TODO: image.rotation is (mSensorOrientation + mCamOriDetector->getOrientation()) % 360 */
     params->rotation = mSensorOrientation % 360;
     params->format = pvl_image_format_gray;
-    params->stride = buffer.s.stride;
+    params->stride = width;
     params->bufferHandle = -1;
     params->cameraId = mCameraId;
 
-    AutoMutex l(mRunBufQueueLock);
-    mRunPvlBufQueue.push(params);
-    mRunCondition.notify_one();
+    FaceDetectionRunParams* staleParams = nullptr;
+    {
+        AutoMutex l(mRunBufQueueLock);
+        // The detector is still busy, replace the frame it hasn't picked up with the newest one
+        if (!mRunPvlBufQueue.empty()) {
+            staleParams = mRunPvlBufQueue.front();
+            mRunPvlBufQueue.pop();
+        }
+        mRunPvlBufQueue.push(params);
+        mRunCondition.notify_one();
+    }
+
+    if (staleParams) {
+        LOG2("@%s, drop the stale face frame", __func__);
+        returnRunBuf(staleParams);
+    }
 }
 
 bool FaceDetectionPVL::threadLoop() {
@@ -192,9 +219,10 @@ bool FaceDetectionPVL::threadLoop() {
 
     nsecs_t startTime = CameraUtils::systemTime();
     int ret = mFace->run(faceParams, sizeof(FaceDetectionRunParams));
+    nsecs_t latency = CameraUtils::systemTime() - startTime;
+    updateFDRunLatency(latency);
     printfFDRunRate();
-    LOG2("@%s: ret:%d, it takes need %ums", __func__, ret,
-         (unsigned)((CameraUtils::systemTime() - startTime) / 1000000));
+    LOG2("@%s: ret:%d, it takes need %ums", __func__, ret, (unsigned)(latency / 1000000));
 
     {
         AutoMutex l(mFaceResultLock);
@@ -42,7 +42,10 @@ namespace icamera {
         }                                   \
     } while (0)
 
-CameraHal::CameraHal() : mInitTimes(0), mState(HAL_UNINIT), mCameraOpenNum(0) {
+CameraHal::CameraHal()
+        : mInitTimes(0),
+          mState(HAL_UNINIT),
+          mCameraOpenNum(0) {
     LOG1("@%s", __func__);
 
     CLEAR(mCameraDevices);
@@ -62,6 +65,8 @@ int CameraHal::init() {
     AutoMutex lock(mLock);
 
     if (mInitTimes++ > 0) {
+        // The last deinit() may be waiting for the camera locks, it won't release anything now
+        mState = HAL_INIT;
         LOGI("already initialized, mInitTimes:%d", mInitTimes);
         return OK;
     }
@@ -84,11 +89,32 @@ int CameraHal::init() {
 int CameraHal::deinit() {
     LOG1("@%s", __func__);
     PERF_CAMERA_ATRACE();
-    AutoMutex l(mLock);
+    {
+        AutoMutex lock(mLock);
+        if (mInitTimes > 1) {
+            mInitTimes--;
+            LOGI("CameraHal still running, mInitTimes:%d", mInitTimes);
+            return OK;
+        }
+        // Reject the new opens
+        mState = HAL_DEINIT;
+    }
+
+    // The device APIs only hold the camera locks, and they still use the PlatformData and
+    // SyncManager instances released below. Wait for the ones in progress, opens included.
+    for (auto& cameraLock : mCameraLocks) cameraLock.lock();
+    deinitLocked();
+    for (auto& cameraLock : mCameraLocks) cameraLock.unlock();
+
+    return OK;
+}
 
+void CameraHal::deinitLocked() {
+    AutoMutex lock(mLock);
     if (--mInitTimes > 0) {
+        // init() was called again while waiting for the camera locks
         LOGI("CameraHal still running, mInitTimes:%d", mInitTimes);
-        return OK;
+        return;
     }
 
     // VIRTUAL_CHANNEL_S
@@ -112,14 +138,11 @@ int CameraHal::deinit() {
 #endif
 
     mState = HAL_UNINIT;
-
-    return OK;
 }
 
 int CameraHal::deviceOpen(int cameraId, int vcNum) {
     LOG1("<id%d> @%s SENSORCTRLINFO: vcNum %d", cameraId, __func__, vcNum);
-    AutoMutex l(mLock);
-    CheckAndLogError(mState == HAL_UNINIT, NO_INIT, "HAL is not initialized");
+    AutoMutex cameraLock(mCameraLocks[cameraId]);
 
     // Create the camera device that will be freed in close
     if (mCameraDevices[cameraId]) {
@@ -127,57 +150,72 @@ int CameraHal::deviceOpen(int cameraId, int vcNum) {
         return INVALID_OPERATION;
     }
 
-    if (mCameraShm.CameraDeviceOpen(cameraId) != OK) return INVALID_OPERATION;
-
-    mCameraDevices[cameraId] = new CameraDevice(cameraId);
-
-    // VIRTUAL_CHANNEL_S
-    camera_info_t info;
-    CLEAR(info);
-    PlatformData::getCameraInfo(cameraId, info);
-    int groupId = info.vc.group >= 0 ? info.vc.group : 0;
-    mTotalVirtualChannelCamNum[groupId] = vcNum;
-    // VIRTUAL_CHANNEL_E
+    {
+        // Only the open count and the topology reset of the first camera are serialized,
+        // the camera device is created and initialized without blocking other cameras.
+        AutoMutex l(mLock);
+        CheckAndLogError(mState != HAL_INIT, NO_INIT, "HAL is not initialized");
 
-    // The check is to handle dual camera cases
-    mCameraOpenNum = mCameraShm.cameraDeviceOpenNum();
-    CheckAndLogError(mCameraOpenNum == 0, INVALID_OPERATION, "camera open num couldn't be 0");
+        if (mCameraShm.CameraDeviceOpen(cameraId) != OK) return INVALID_OPERATION;
 
-    if (mCameraOpenNum == 1) {
-        MediaControl* mc = MediaControl::getInstance();
-        CheckAndLogError(!mc, UNKNOWN_ERROR, "MediaControl init failed");
+        // VIRTUAL_CHANNEL_S
+        camera_info_t info;
+        CLEAR(info);
+        PlatformData::getCameraInfo(cameraId, info);
+        int groupId = info.vc.group >= 0 ? info.vc.group : 0;
+        mTotalVirtualChannelCamNum[groupId] = vcNum;
+        // VIRTUAL_CHANNEL_E
 
-        if (PlatformData::isResetLinkRoute(cameraId)) {
-            int ret = mc->resetAllLinks();
-            CheckAndLogError(ret != OK, DEV_BUSY, "resetAllLinks failed");
+        // The check is to handle dual camera cases
+        mCameraOpenNum = mCameraShm.cameraDeviceOpenNum();
+        if (mCameraOpenNum == 0) {
+            LOGE("camera open num couldn't be 0");
+            mCameraShm.CameraDeviceClose(cameraId);
+            return INVALID_OPERATION;
         }
-        // VIRTUAL_CHANNEL_S
-        if (info.vc.total_num) {
-            // when the sensor belongs to virtual channel, reset the routes
-            if (PlatformData::isResetLinkRoute(cameraId)) mc->resetAllRoutes(cameraId);
+
+        if (mCameraOpenNum == 1) {
+            MediaControl* mc = MediaControl::getInstance();
+            int ret = mc ? OK : UNKNOWN_ERROR;
+            if (mc && PlatformData::isResetLinkRoute(cameraId)) {
+                ret = mc->resetAllLinks() == OK ? OK : DEV_BUSY;
+            }
+            if (ret != OK) {
+                LOGE("<id%d> failed to reset the media topology", cameraId);
+                mCameraShm.CameraDeviceClose(cameraId);
+                return ret;
+            }
+            // VIRTUAL_CHANNEL_S
+            if (info.vc.total_num) {
+                // when the sensor belongs to virtual channel, reset the routes
+                if (PlatformData::isResetLinkRoute(cameraId)) mc->resetAllRoutes(cameraId);
+            }
+            // VIRTUAL_CHANNEL_E
         }
-        // VIRTUAL_CHANNEL_E
     }
 
+    mCameraDevices[cameraId] = new CameraDevice(cameraId);
+
     return mCameraDevices[cameraId]->init();
 }
 
 void CameraHal::deviceClose(int cameraId) {
     LOG1("<id%d> @%s", cameraId, __func__);
-    AutoMutex l(mLock);
+    AutoMutex cameraLock(mCameraLocks[cameraId]);
 
     if (mCameraDevices[cameraId]) {
         mCameraDevices[cameraId]->deinit();
         delete mCameraDevices[cameraId];
         mCameraDevices[cameraId] = nullptr;
 
+        AutoMutex l(mLock);
         mCameraShm.CameraDeviceClose(cameraId);
     }
 }
 
 void CameraHal::deviceCallbackRegister(int cameraId, const camera_callback_ops_t* callback) {
     LOG1("<id%d> @%s", cameraId, __func__);
-    AutoMutex l(mLock);
+    AutoMutex l(mCameraLocks[cameraId]);
 
     CameraDevice* device = mCameraDevices[cameraId];
     checkCameraDevice(device, VOID_VALUE);
@@ -190,7 +228,7 @@ void CameraHal::deviceCallbackRegister(int cameraId, const camera_callback_ops_t
 // Assume the inputConfig is already checked in upper layer
 int CameraHal::deviceConfigInput(int cameraId, const stream_t* inputConfig) {
     LOG1("<id%d> @%s", cameraId, __func__);
-    AutoMutex lock(mLock);
+    AutoMutex lock(mCameraLocks[cameraId]);
 
     CameraDevice* device = mCameraDevices[cameraId];
     checkCameraDevice(device, BAD_VALUE);
@@ -203,7 +241,7 @@ int CameraHal::deviceConfigInput(int cameraId, const stream_t* inputConfig) {
 // Assume the streamList is already checked in upper layer
 int CameraHal::deviceConfigStreams(int cameraId, stream_config_t* streamList) {
     LOG1("<id%d> @%s", cameraId, __func__);
-    AutoMutex lock(mLock);
+    AutoMutex cameraLock(mCameraLocks[cameraId]);
 
     CameraDevice* device = mCameraDevices[cameraId];
     checkCameraDevice(device, BAD_VALUE);
@@ -219,6 +257,7 @@ int CameraHal::deviceConfigStreams(int cameraId, stream_config_t* streamList) {
     CLEAR(info);
     PlatformData::getCameraInfo(cameraId, info);
     int groupId = info.vc.group >= 0 ? info.vc.group : 0;
+    AutoMutex lock(mLock);
     if (mTotalVirtualChannelCamNum[groupId] > 0) {
         mConfigTimes[groupId]++;
         LOG1("<id%d> @%s, mConfigTimes:%d, before signal", cameraId, __func__,
@@ -232,7 +271,7 @@ int CameraHal::deviceConfigStreams(int cameraId, stream_config_t* streamList) {
 
 int CameraHal::deviceStart(int cameraId) {
     LOG1("<id%d> @%s", cameraId, __func__);
-    ConditionLock lock(mLock);
+    AutoMutex cameraLock(mCameraLocks[cameraId]);
 
     CameraDevice* device = mCameraDevices[cameraId];
     checkCameraDevice(device, BAD_VALUE);
@@ -242,6 +281,7 @@ int CameraHal::deviceStart(int cameraId) {
     CLEAR(info);
     PlatformData::getCameraInfo(cameraId, info);
     int groupId = info.vc.group >= 0 ? info.vc.group : 0;
+    ConditionLock lock(mLock);
     LOG1("<id%d> @%s, mConfigTimes:%d, mTotalVirtualChannelCamNum:%d", cameraId, __func__,
          mConfigTimes[groupId], mTotalVirtualChannelCamNum[groupId]);
 
@@ -256,6 +296,7 @@ int CameraHal::deviceStart(int cameraId) {
                              cameraId, mConfigTimes[groupId]);
         }
     }
+    lock.unlock();
     // VIRTUAL_CHANNEL_E
 
     return device->start();
@@ -263,7 +304,7 @@ int CameraHal::deviceStart(int cameraId) {
 
 int CameraHal::deviceStop(int cameraId) {
     LOG1("<id%d> @%s", cameraId, __func__);
-    AutoMutex lock(mLock);
+    AutoMutex lock(mCameraLocks[cameraId]);
 
     CameraDevice* device = mCameraDevices[cameraId];
     checkCameraDevice(device, BAD_VALUE);
@@ -69,9 +69,15 @@ class CameraHal {
  private:
     DISALLOW_COPY_AND_ASSIGN(CameraHal);
 
+    // Release the HAL instances with all the camera locks held
+    void deinitLocked();
+
     CameraDevice* mCameraDevices[MAX_CAMERA_NUMBER];
+    // Guard for the device API of each camera, so the cameras can be operated in parallel.
+    Mutex mCameraLocks[MAX_CAMERA_NUMBER];
     int mInitTimes;
-    // Guard for CameraHal public API.
+    // Guard for the HAL init state, the opened camera count and the virtual channel groups.
+    // When both are needed, mCameraLocks must be acquired before mLock.
     Mutex mLock;
     // VIRTUAL_CHANNEL_S
     int mTotalVirtualChannelCamNum[MAX_VC_GROUP_NUMBER];
@@ -80,7 +86,8 @@ class CameraHal {
     static const nsecs_t mWaitDuration = 500000000;  // 500ms
     // VIRTUAL_CHANNEL_E
 
-    enum { HAL_UNINIT, HAL_INIT } mState;
+    // HAL_DEINIT: the last deinit() is waiting for the camera locks, no new open allowed
+    enum { HAL_UNINIT, HAL_INIT, HAL_DEINIT } mState;
 
     // Used to store variables in different process
     CameraSharedMemory mCameraShm;
@@ -35,6 +35,13 @@ class IImageProcessor {
                                std::shared_ptr<camera3::Camera3Buffer>& output) = 0;
     virtual status_t scaleFrame(const std::shared_ptr<camera3::Camera3Buffer>& input,
                                 std::shared_ptr<camera3::Camera3Buffer>& output) = 0;
+    /**
+     * Crop the center cropWidth x cropHeight region of input and scale it into output
+     * in one pass, without an intermediate cropped frame.
+     */
+    virtual status_t cropAndScaleFrame(const std::shared_ptr<camera3::Camera3Buffer>& input,
+                                       int cropWidth, int cropHeight,
+                                       std::shared_ptr<camera3::Camera3Buffer>& output) = 0;
     virtual status_t rotateFrame(const std::shared_ptr<camera3::Camera3Buffer>& input,
                                  std::shared_ptr<camera3::Camera3Buffer>& output, int angle,
                                  std::vector<uint8_t>& rotateBuf) = 0;
@@ -88,6 +88,27 @@ status_t CropProcess::doPostProcessing(const shared_ptr<camera3::Camera3Buffer>&
     return OK;
 }
 
+CropScaleProcess::CropScaleProcess(int cropWidth, int cropHeight)
+        : PostProcessorBase("CropScaler"),
+          mCropWidth(cropWidth),
+          mCropHeight(cropHeight) {
+    LOG1("@%s create crop and scaler processor, crop: %dx%d", __func__, mCropWidth, mCropHeight);
+    mProcessor = IImageProcessor::createImageProcessor();
+}
+
+status_t CropScaleProcess::doPostProcessing(const shared_ptr<camera3::Camera3Buffer>& inBuf,
+                                            shared_ptr<camera3::Camera3Buffer>& outBuf) {
+    LOG1("@%s processor name: %s", __func__, mName.c_str());
+    CheckAndLogError(!inBuf, UNKNOWN_ERROR, "%s, the inBuf is nullptr", __func__);
+    CheckAndLogError(!outBuf, UNKNOWN_ERROR, "%s, the outBuf is nullptr", __func__);
+
+    int ret = mProcessor->cropAndScaleFrame(inBuf, mCropWidth, mCropHeight, outBuf);
+    CheckAndLogError(ret != OK, UNKNOWN_ERROR, "Failed to do post processing, name: %s",
+                     mName.c_str());
+
+    return OK;
+}
+
 ConvertProcess::ConvertProcess() : PostProcessorBase("Convert") {
     LOG1("@%s create convert processor", __func__);
     mProcessor = IImageProcessor::createImageProcessor();
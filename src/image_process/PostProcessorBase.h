@@ -84,6 +84,19 @@ class CropProcess : public PostProcessorBase {
                                       std::shared_ptr<camera3::Camera3Buffer>& outBuf);
 };
 
+class CropScaleProcess : public PostProcessorBase {
+ public:
+    CropScaleProcess(int cropWidth, int cropHeight);
+    ~CropScaleProcess(){};
+
+    virtual status_t doPostProcessing(const std::shared_ptr<camera3::Camera3Buffer>& inBuf,
+                                      std::shared_ptr<camera3::Camera3Buffer>& outBuf);
+
+ private:
+    int mCropWidth;
+    int mCropHeight;
+};
+
 class ConvertProcess : public PostProcessorBase {
  public:
     ConvertProcess();
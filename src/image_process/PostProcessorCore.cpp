@@ -18,6 +18,8 @@
 
 #include "PostProcessorCore.h"
 
+#include <inttypes.h>
+
 #include "HALv3Utils.h"
 #include "iutils/CameraLog.h"
 
@@ -25,12 +27,60 @@ using std::shared_ptr;
 
 namespace icamera {
 
-PostProcessorCore::PostProcessorCore(int cameraId) : mCameraId(cameraId) {}
+PostProcessorCore::PostProcessorCore(int cameraId) : mCameraId(cameraId), mBytesPerFrame(0) {}
 
 bool PostProcessorCore::isPostProcessTypeSupported(PostProcessType type) {
     return IImageProcessor::isProcessingTypeSupported(type);
 }
 
+uint64_t PostProcessorCore::getStageBytes(const PostProcessInfo& info) {
+    uint64_t bytes = CameraUtils::getFrameSize(info.inputInfo.format, info.inputInfo.width,
+                                               info.inputInfo.height);
+    // The size of the jpeg output is content dependent, only the input is counted
+    if (info.type != POST_PROCESS_JPEG_ENCODING) {
+        bytes += CameraUtils::getFrameSize(info.outputInfo.format, info.outputInfo.width,
+                                           info.outputInfo.height);
+    }
+
+    return bytes;
+}
+
+void PostProcessorCore::planProcessors(const std::vector<PostProcessInfo>& processorOrder) {
+    mProcessorsInfo.clear();
+    uint64_t unfusedBytes = 0;
+    mBytesPerFrame = 0;
+
+    for (size_t i = 0; i < processorOrder.size(); i++) {
+        PostProcessInfo info = processorOrder[i];
+        unfusedBytes += getStageBytes(info);
+
+        // Crop then scaling on NV12 can be done in one pass over the cropped region
+        if (info.type == POST_PROCESS_CROP && i + 1 < processorOrder.size() &&
+            processorOrder[i + 1].type == POST_PROCESS_SCALING &&
+            info.inputInfo.format == V4L2_PIX_FMT_NV12 &&
+            processorOrder[i + 1].outputInfo.format == V4L2_PIX_FMT_NV12 &&
+            IImageProcessor::isProcessingTypeSupported(POST_PROCESS_CROP_SCALING)) {
+            i++;
+            unfusedBytes += getStageBytes(processorOrder[i]);
+
+            info.type = POST_PROCESS_CROP_SCALING;
+            info.cropWidth = info.outputInfo.width;
+            info.cropHeight = info.outputInfo.height;
+            info.outputInfo = processorOrder[i].outputInfo;
+            LOG2("%s, fuse crop %dx%d and scaling to %dx%d", __func__, info.cropWidth,
+                 info.cropHeight, info.outputInfo.width, info.outputInfo.height);
+        }
+
+        mBytesPerFrame += getStageBytes(info);
+        mProcessorsInfo.push_back(info);
+    }
+
+    LOG1("<id%d>@%s, %zu stages planned to %zu, bytes moved per frame %" PRIu64
+         " (unfused %" PRIu64 ")",
+         mCameraId, __func__, processorOrder.size(), mProcessorsInfo.size(), mBytesPerFrame,
+         unfusedBytes);
+}
+
 status_t PostProcessorCore::createProcessor() {
     mProcessorVector.clear();
     for (const auto& order : mProcessorsInfo) {
@@ -45,6 +95,9 @@ status_t PostProcessorCore::createProcessor() {
             case POST_PROCESS_CROP:
                 processor = std::make_shared<CropProcess>();
                 break;
+            case POST_PROCESS_CROP_SCALING:
+                processor = std::make_shared<CropScaleProcess>(order.cropWidth, order.cropHeight);
+                break;
             case POST_PROCESS_CONVERT:
                 processor = std::make_shared<ConvertProcess>();
                 break;
@@ -75,6 +128,24 @@ status_t PostProcessorCore::allocateBuffers() {
         const stream_t& info = mProcessorsInfo[i].outputInfo;
         int gfxFormat =
             camera3::HalV3Utils::V4l2FormatToHALFormat(mProcessorsInfo[i].inputInfo.format);
+
+        /*
+         * The output of stage i - 2 has been consumed by stage i - 1 when stage i runs,
+         * so its buffer can be reused if the frame info is the same.
+         */
+        if (i >= 2) {
+            const PostProcessInfo& pingInfo = mProcessorsInfo[i - 2];
+            if (pingInfo.outputInfo.width == info.width &&
+                pingInfo.outputInfo.height == info.height &&
+                pingInfo.inputInfo.format == mProcessorsInfo[i].inputInfo.format) {
+                LOG2("%s, processor %s reuses the buffer of %s", __func__,
+                     mProcessorVector[i]->getName().c_str(),
+                     mProcessorVector[i - 2]->getName().c_str());
+                mInterBuffers.push_back(mInterBuffers[i - 2]);
+                continue;
+            }
+        }
+
         std::shared_ptr<camera3::Camera3Buffer> buf = camera3::MemoryUtils::allocateHandleBuffer(
             info.width, info.height, gfxFormat,
             (GRALLOC_USAGE_SW_READ_MASK | GRALLOC_USAGE_SW_WRITE_MASK |
@@ -86,7 +157,7 @@ status_t PostProcessorCore::allocateBuffers() {
                  mProcessorVector[i]->getName().c_str());
             return icamera::NO_MEMORY;
         }
-        mInterBuffers[mProcessorVector[i]] = buf;
+        mInterBuffers.push_back(buf);
     }
 
     return OK;
@@ -95,7 +166,7 @@ status_t PostProcessorCore::allocateBuffers() {
 status_t PostProcessorCore::configure(const std::vector<PostProcessInfo>& processorOrder) {
     if (processorOrder.empty()) return OK;
 
-    mProcessorsInfo = processorOrder;
+    planProcessors(processorOrder);
     int ret = createProcessor();
     CheckAndLogError(ret != OK, ret, "%s, Failed to create the post processor", __func__);
 
@@ -117,7 +188,7 @@ status_t PostProcessorCore::doPostProcessing(const shared_ptr<camera3::Camera3Bu
         if (i == (mProcessorVector.size() - 1)) {
             output = outBuf;
         } else {
-            output = mInterBuffers[mProcessorVector[i]];
+            output = mInterBuffers[i];
         }
 
         int ret = OK;
@@ -130,6 +201,8 @@ status_t PostProcessorCore::doPostProcessing(const shared_ptr<camera3::Camera3Bu
 
         input = output;
     }
+    LOG2("<id%d>@%s, %" PRIu64 " bytes moved by %zu stages", mCameraId, __func__, mBytesPerFrame,
+         mProcessorVector.size());
 
     return OK;
 }
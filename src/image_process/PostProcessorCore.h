@@ -16,7 +16,6 @@
 
 #pragma once
 
-#include <map>
 #include <vector>
 
 #include "PostProcessorBase.h"
@@ -31,7 +30,10 @@ struct PostProcessInfo {
     stream_t outputInfo;
     PostProcessType type;
     int angle;
-    PostProcessInfo() : type(POST_PROCESS_NONE), angle(0) {
+    // The center region cropped before scaling, only for POST_PROCESS_CROP_SCALING
+    int cropWidth;
+    int cropHeight;
+    PostProcessInfo() : type(POST_PROCESS_NONE), angle(0), cropWidth(0), cropHeight(0) {
         CLEAR(inputInfo);
         CLEAR(outputInfo);
     }
@@ -42,6 +44,9 @@ struct PostProcessInfo {
  *
  * This class is used to encode JPEG and rotate image.
  *
+ * The processor order is planned at configure time: adjacent crop and scaling
+ * stages are fused into one pass, and the intermediate buffers are shared in
+ * ping-pong fashion between stages which have the same frame info.
  */
 class PostProcessorCore {
  public:
@@ -55,17 +60,20 @@ class PostProcessorCore {
                               std::shared_ptr<camera3::Camera3Buffer> outBuf);
 
  private:
+    void planProcessors(const std::vector<PostProcessInfo>& processorOrder);
     status_t createProcessor();
     status_t allocateBuffers();
+    static uint64_t getStageBytes(const PostProcessInfo& info);
 
  private:
     DISALLOW_COPY_AND_ASSIGN(PostProcessorCore);
 
  private:
     int mCameraId;
-    std::map<std::shared_ptr<PostProcessorBase>, std::shared_ptr<camera3::Camera3Buffer>>
-        mInterBuffers;
+    // The output buffer of each stage except the last one, indexed by stage
+    std::vector<std::shared_ptr<camera3::Camera3Buffer>> mInterBuffers;
     std::vector<PostProcessInfo> mProcessorsInfo;
     std::vector<std::shared_ptr<PostProcessorBase>> mProcessorVector;
+    uint64_t mBytesPerFrame;  // The memory read and written by the chain for one frame
 };
 }  // namespace icamera
@@ -24,7 +24,9 @@ enum PostProcessType {
     POST_PROCESS_SCALING = 1 << 1,
     POST_PROCESS_CROP = 1 << 2,
     POST_PROCESS_CONVERT = 1 << 3,
-    POST_PROCESS_JPEG_ENCODING = 1 << 4
+    POST_PROCESS_JPEG_ENCODING = 1 << 4,
+    // Fused crop + scaling in one pass, only planned internally by PostProcessorCore
+    POST_PROCESS_CROP_SCALING = POST_PROCESS_CROP | POST_PROCESS_SCALING
 };
 
 }  // namespace icamera
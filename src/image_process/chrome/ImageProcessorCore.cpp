@@ -34,12 +34,13 @@ std::unique_ptr<IImageProcessor> IImageProcessor::createImageProcessor() {
     return std::unique_ptr<ImageProcessorCore>(new ImageProcessorCore());
 }
 
-// If support this kind of post process type in current OS
+// If support this kind of post process type in current OS, a combined type such as
+// POST_PROCESS_CROP_SCALING needs all of its bits
 bool IImageProcessor::isProcessingTypeSupported(PostProcessType type) {
     int supportedType = POST_PROCESS_ROTATE | POST_PROCESS_SCALING | POST_PROCESS_CROP |
                         POST_PROCESS_CONVERT | POST_PROCESS_JPEG_ENCODING;
 
-    return supportedType & type;
+    return (supportedType & type) == type;
 }
 
 status_t ImageProcessorCore::cropFrame(const std::shared_ptr<camera3::Camera3Buffer>& input,
@@ -109,6 +110,41 @@ status_t ImageProcessorCore::scaleFrame(const std::shared_ptr<camera3::Camera3Bu
     return OK;
 }
 
+status_t ImageProcessorCore::cropAndScaleFrame(
+    const std::shared_ptr<camera3::Camera3Buffer>& input, int cropWidth, int cropHeight,
+    std::shared_ptr<camera3::Camera3Buffer>& output) {
+    LOG2("%s: src: %dx%d,format 0x%x, crop: %dx%d, dest: %dx%d format 0x%x", __func__,
+         input->width(), input->height(), input->v4l2Fmt(), cropWidth, cropHeight,
+         output->width(), output->height(), output->v4l2Fmt());
+
+    CheckAndLogError(cropWidth > input->width() || cropHeight > input->height(), BAD_VALUE,
+                     "crop region [%d x %d] is out of input [%d x %d]", cropWidth, cropHeight,
+                     input->width(), input->height());
+
+    // Keep the crop origin on even pixels so that the UV plane stays aligned with Y
+    int left = ((input->width() - cropWidth) / 2) & ~1;
+    int top = ((input->height() - cropHeight) / 2) & ~1;
+    int inStride = input->stride();
+    int outStride = output->stride();
+
+    // Y plane
+    const uint8_t* inY = static_cast<uint8_t*>(input->data()) + top * inStride + left;
+    libyuv::ScalePlane(inY, inStride, cropWidth, cropHeight,
+                       static_cast<uint8_t*>(output->data()), outStride, output->width(),
+                       output->height(), libyuv::kFilterNone);
+
+    // UV plane
+    int inUVOffsetByte = inStride * input->height() + (top / 2) * inStride + left;
+    int outUVOffsetByte = outStride * output->height();
+    libyuv::ScalePlane_16(
+        static_cast<uint16_t*>(input->data()) + inUVOffsetByte / sizeof(uint16_t), inStride / 2,
+        cropWidth / 2, cropHeight / 2,
+        static_cast<uint16_t*>(output->data()) + outUVOffsetByte / sizeof(uint16_t),
+        outStride / 2, output->width() / 2, output->height() / 2, libyuv::kFilterNone);
+
+    return OK;
+}
+
 status_t ImageProcessorCore::rotateFrame(const std::shared_ptr<camera3::Camera3Buffer>& input,
                                          std::shared_ptr<camera3::Camera3Buffer>& output, int angle,
                                          std::vector<uint8_t>& rotateBuf) {
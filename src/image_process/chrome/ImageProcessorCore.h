@@ -32,6 +32,9 @@ class ImageProcessorCore : public IImageProcessor {
                                std::shared_ptr<camera3::Camera3Buffer>& output);
     virtual status_t scaleFrame(const std::shared_ptr<camera3::Camera3Buffer>& input,
                                 std::shared_ptr<camera3::Camera3Buffer>& output);
+    virtual status_t cropAndScaleFrame(const std::shared_ptr<camera3::Camera3Buffer>& input,
+                                       int cropWidth, int cropHeight,
+                                       std::shared_ptr<camera3::Camera3Buffer>& output);
     virtual status_t rotateFrame(const std::shared_ptr<camera3::Camera3Buffer>& input,
                                  std::shared_ptr<camera3::Camera3Buffer>& output, int angle,
                                  std::vector<uint8_t>& rotateBuf);
@@ -71,7 +71,7 @@ void SwImageConverter::YUV2RGB(unsigned char Y, unsigned char U, unsigned char V
 void SwImageConverter::convertBayerBlock(unsigned int x, unsigned int y, unsigned int width,
                                          unsigned int height, unsigned short bayer_data[4],
                                          unsigned char* out_buf, unsigned int src_fmt,
-                                         unsigned int dst_fmt) {
+                                         unsigned int dst_fmt, int dstStride) {
     unsigned char* Ybase;
     unsigned char* UVbase;
     unsigned char Y, U, V;
@@ -153,7 +153,6 @@ void SwImageConverter::convertBayerBlock(unsigned int x, unsigned int y, unsigne
             return;
     }
 
-    int dstStride = CameraUtils::getStride(dst_fmt, width);
     switch (dst_fmt) {
         case V4L2_PIX_FMT_SRGGB8:
             out_buf[y * dstStride + x] = (R >> 2);
@@ -260,14 +259,13 @@ void SwImageConverter::convertBayerBlock(unsigned int x, unsigned int y, unsigne
 void SwImageConverter::convertYuvBlock(unsigned int x, unsigned int y, unsigned int width,
                                        unsigned int height, unsigned char* in_buf,
                                        unsigned char* out_buf, unsigned int src_fmt,
-                                       unsigned int dst_fmt) {
+                                       unsigned int dst_fmt, int srcStride, int dstStride) {
     unsigned char* YBase;
     unsigned char* UVBase;
     unsigned char Y[4];
     unsigned char U[4];
     unsigned char V[4];
     unsigned short R, G, B;
-    int srcStride = CameraUtils::getStride(src_fmt, width);
 
     switch (src_fmt) {
         case V4L2_PIX_FMT_NV12:
@@ -304,7 +302,6 @@ void SwImageConverter::convertYuvBlock(unsigned int x, unsigned int y, unsigned
             return;
     }
 
-    int dstStride = CameraUtils::getStride(dst_fmt, width);
     switch (dst_fmt) {
         case V4L2_PIX_FMT_NV12:
             YBase = out_buf;
@@ -435,25 +432,31 @@ int SwImageConverter::convertFormat(unsigned int width, unsigned int height, uns
     }
 
     // for not vector raw
+    // Resolve the format properties once instead of per block
     int srcStride = CameraUtils::getStride(srcFmt, width);
+    int dstStride = CameraUtils::getStride(dstFmt, width);
+    bool isRawSrc = CameraUtils::isRaw(srcFmt);
+    int srcBpp = CameraUtils::getBpp(srcFmt);
     for (y = 0; y < height; y += 2) {
         for (x = 0; x < width; x += 2) {
-            if (CameraUtils::isRaw(srcFmt)) {
-                if (CameraUtils::getBpp(srcFmt) == 8) {
+            if (isRawSrc) {
+                if (srcBpp == 8) {
                     bayer_data[0] = inBuf[y * srcStride + x];
                     bayer_data[1] = inBuf[y * srcStride + x + 1];
                     bayer_data[2] = inBuf[(y + 1) * srcStride + x];
                     bayer_data[3] = inBuf[(y + 1) * srcStride + x + 1];
                 } else {
-                    int offset = srcStride / (CameraUtils::getBpp(srcFmt) / 8);
+                    int offset = srcStride / (srcBpp / 8);
                     bayer_data[0] = *((unsigned short*)inBuf + y * offset + x);
                     bayer_data[1] = *((unsigned short*)inBuf + y * offset + x + 1);
                     bayer_data[2] = *((unsigned short*)inBuf + (y + 1) * offset + x);
                     bayer_data[3] = *((unsigned short*)inBuf + (y + 1) * offset + x + 1);
                 }
-                convertBayerBlock(x, y, width, height, bayer_data, outBuf, srcFmt, dstFmt);
+                convertBayerBlock(x, y, width, height, bayer_data, outBuf, srcFmt, dstFmt,
+                                  dstStride);
             } else {
-                convertYuvBlock(x, y, width, height, inBuf, outBuf, srcFmt, dstFmt);
+                convertYuvBlock(x, y, width, height, inBuf, outBuf, srcFmt, dstFmt, srcStride,
+                                dstStride);
             }
         }
     }
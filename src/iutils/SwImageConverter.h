@@ -25,13 +25,14 @@ void RGB2YUV(unsigned short R, unsigned short G, unsigned short B, unsigned char
 void YUV2RGB(unsigned char Y, unsigned char U, unsigned char V, unsigned short* R,
              unsigned short* G, unsigned short* B);
 
+// The strides are resolved once per frame by the caller
 void convertBayerBlock(unsigned int x, unsigned int y, unsigned int width, unsigned int height,
                        unsigned short bayer_data[4], unsigned char* out_buf, unsigned int src_fmt,
-                       unsigned int dst_fmt);
+                       unsigned int dst_fmt, int dstStride);
 
 void convertYuvBlock(unsigned int x, unsigned int y, unsigned int width, unsigned int height,
                      unsigned char* in_buf, unsigned char* out_buf, unsigned int src_fmt,
-                     unsigned int dst_fmt);
+                     unsigned int dst_fmt, int srcStride, int dstStride);
 
 // convert the buffer from the src_fmt to the dst_fmt
 int convertFormat(unsigned int width, unsigned int height, unsigned char* inBuf,
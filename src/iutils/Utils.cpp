@@ -30,6 +30,7 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <unordered_map>
 
 #include "iutils/CameraLog.h"
 #include "iutils/Errors.h"
@@ -181,6 +182,38 @@ static const FormatInfo gFormatMapping[] = {
     {V4L2_PIX_FMT_SGRBG12, GET_FOURCC_FMT('B', 'A', '1', '2'), "GRBG12", "BA12", 16, FORMAT_FOURCC},
 };
 
+/**
+ * Hash indexes of gFormatMapping, so the format queries don't scan the table.
+ * A code may appear in several entries, the first one wins as the scan did before.
+ */
+struct FormatIndex {
+    std::unordered_map<int, const FormatInfo*> anyFmt;  // match either v4l2Fmt or iaFourcc
+    std::unordered_map<int, const FormatInfo*> v4l2Fmt;
+    std::unordered_map<int, const FormatInfo*> iaFourcc;
+
+    FormatIndex() {
+        for (size_t i = 0; i < ARRAY_SIZE(gFormatMapping); i++) {
+            const FormatInfo* info = &gFormatMapping[i];
+            anyFmt.emplace(info->v4l2Fmt, info);
+            anyFmt.emplace(info->iaFourcc, info);
+            v4l2Fmt.emplace(info->v4l2Fmt, info);
+            iaFourcc.emplace(info->iaFourcc, info);
+        }
+    }
+};
+
+static const FormatIndex& getFormatIndex() {
+    // Built on first use, so it's valid for the static initializers in other files too.
+    static const FormatIndex sFormatIndex;
+    return sFormatIndex;
+}
+
+static const FormatInfo* findFormat(const std::unordered_map<int, const FormatInfo*>& index,
+                                    int format) {
+    auto it = index.find(format);
+    return (it != index.end()) ? it->second : nullptr;
+}
+
 struct TuningModeStringInfo {
     TuningMode mode;
     const char* str;
@@ -225,12 +258,8 @@ TuningMode CameraUtils::string2TuningMode(const char* str) {
 }
 
 const char* CameraUtils::pixelCode2String(int code) {
-    int size = ARRAY_SIZE(gFormatMapping);
-    for (int i = 0; i < size; i++) {
-        if (gFormatMapping[i].v4l2Fmt == code || gFormatMapping[i].iaFourcc == code) {
-            return gFormatMapping[i].fullName;
-        }
-    }
+    const FormatInfo* info = findFormat(getFormatIndex().anyFmt, code);
+    if (info) return info->fullName;
 
     LOGE("Invalid Pixel Format: %d", code);
     return "INVALID FORMAT";
@@ -280,12 +309,8 @@ const string CameraUtils::fourcc2String(int format4cc) {
 }
 
 std::string CameraUtils::format2string(int format) {
-    int size = ARRAY_SIZE(gFormatMapping);
-    for (int i = 0; i < size; i++) {
-        if (gFormatMapping[i].v4l2Fmt == format || gFormatMapping[i].iaFourcc == format) {
-            return std::string(gFormatMapping[i].shortName);
-        }
-    }
+    const FormatInfo* info = findFormat(getFormatIndex().anyFmt, format);
+    if (info) return std::string(info->shortName);
 
     LOG2("%s, Not in our format list :%x", __func__, format);
     return fourcc2String(format);
@@ -306,24 +331,16 @@ bool CameraUtils::isPlanarFormat(int format) {
 }
 
 bool CameraUtils::isRaw(int format) {
-    int size = ARRAY_SIZE(gFormatMapping);
-    for (int i = 0; i < size; i++) {
-        if (gFormatMapping[i].v4l2Fmt == format) {
-            // Both normal raw and vector raw treated as raw here.
-            return gFormatMapping[i].type == FORMAT_RAW_VEC || gFormatMapping[i].type == FORMAT_RAW;
-        }
-    }
+    const FormatInfo* info = findFormat(getFormatIndex().v4l2Fmt, format);
+    if (!info) return false;
 
-    return false;
+    // Both normal raw and vector raw treated as raw here.
+    return info->type == FORMAT_RAW_VEC || info->type == FORMAT_RAW;
 }
 
 int CameraUtils::getBpp(int format) {
-    int size = ARRAY_SIZE(gFormatMapping);
-    for (int i = 0; i < size; i++) {
-        if (gFormatMapping[i].v4l2Fmt == format || gFormatMapping[i].iaFourcc == format) {
-            return gFormatMapping[i].bpp;
-        }
-    }
+    const FormatInfo* info = findFormat(getFormatIndex().anyFmt, format);
+    if (info) return info->bpp;
 
     LOGE("There is no bpp supplied for format %s", pixelCode2String(format));
     return -1;
@@ -414,9 +431,8 @@ int32_t CameraUtils::getBpl(int32_t format, int32_t width) {
 }
 
 int32_t CameraUtils::getV4L2Format(const int32_t iaFourcc) {
-    for (size_t i = 0; i < ARRAY_SIZE(gFormatMapping); i++) {
-        if (gFormatMapping[i].iaFourcc == iaFourcc) return gFormatMapping[i].v4l2Fmt;
-    }
+    const FormatInfo* info = findFormat(getFormatIndex().iaFourcc, iaFourcc);
+    if (info) return info->v4l2Fmt;
 
     LOGE("Failed to find any V4L2 format with format %s", pixelCode2String(iaFourcc));
 
@@ -545,8 +561,11 @@ int CameraUtils::getFrameSize(int format, int width, int height, bool needAligne
         height = ALIGN_64(height);
         LOG2("@%s buffer aligned height %d", __func__, height);
     }
-    int bufferHeight =
-        isPlanarFormat(format) ? ((height * getBpp(format) / 8) / getPlanarByte(format)) : height;
+    // Resolve the format properties once
+    bool isPlanar = isPlanarFormat(format);
+    int bpp = getBpp(format);
+    int planarByte = isPlanar ? getPlanarByte(format) : 1;
+    int bufferHeight = isPlanar ? ((height * bpp / 8) / planarByte) : height;
 
     if (!needExtraSize) {
         LOG2("%s: no need extra size, frame size is %d", __func__, alignedBpl * bufferHeight);
@@ -559,9 +578,7 @@ int CameraUtils::getFrameSize(int format, int width, int height, bool needAligne
     }
 
     // Extra size should be at least one alignedBpl
-    int extraSize = isPlanarFormat(format) ?
-                        (alignedBpl * getBpp(format) / 8 / getPlanarByte(format)) :
-                        alignedBpl;
+    int extraSize = isPlanar ? (alignedBpl * bpp / 8 / planarByte) : alignedBpl;
     extraSize = std::max(extraSize, 1024);
 
     return alignedBpl * bufferHeight + extraSize;
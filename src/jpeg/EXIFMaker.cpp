@@ -50,6 +50,7 @@ EXIFMaker::EXIFMaker()
     CLEAR(mExifAttributes);
     mMakernoteSection = new unsigned char[MAKERNOTE_SECTION1_SIZE + MAKERNOTE_SECTION2_SIZE];
     readProperty();
+    initDefaultAttributes();
 }
 
 EXIFMaker::~EXIFMaker() {
@@ -484,55 +485,61 @@ void EXIFMaker::copyAttribute(uint8_t* dst, size_t dstSize, const char* src, siz
     dst[len] = '\0';
 }
 
-void EXIFMaker::clear() {
+void EXIFMaker::initDefaultAttributes() {
     LOG1("@%s", __func__);
-    // Reset all the attributes
-    CLEAR(mExifAttributes);
+    CLEAR(mDefaultAttributes);
     // Initialize the common values
-    mExifAttributes.enableThumb = false;
-    copyAttribute(mExifAttributes.image_description, sizeof(mExifAttributes.image_description),
-                  EXIF_DEF_IMAGE_DESCRIPTION, strlen(EXIF_DEF_IMAGE_DESCRIPTION));
+    mDefaultAttributes.enableThumb = false;
+    copyAttribute(mDefaultAttributes.image_description,
+                  sizeof(mDefaultAttributes.image_description), EXIF_DEF_IMAGE_DESCRIPTION,
+                  strlen(EXIF_DEF_IMAGE_DESCRIPTION));
 
-    copyAttribute(mExifAttributes.maker, sizeof(mExifAttributes.maker), mManufacturerName.c_str(),
-                  strlen(mManufacturerName.c_str()));
+    copyAttribute(mDefaultAttributes.maker, sizeof(mDefaultAttributes.maker),
+                  mManufacturerName.c_str(), strlen(mManufacturerName.c_str()));
 
-    copyAttribute(mExifAttributes.model, sizeof(mExifAttributes.model), mProductName.c_str(),
+    copyAttribute(mDefaultAttributes.model, sizeof(mDefaultAttributes.model), mProductName.c_str(),
                   strlen(mProductName.c_str()));
 
-    copyAttribute(mExifAttributes.software, sizeof(mExifAttributes.software), EXIF_DEF_SOFTWARE,
-                  strlen(EXIF_DEF_SOFTWARE));
+    copyAttribute(mDefaultAttributes.software, sizeof(mDefaultAttributes.software),
+                  EXIF_DEF_SOFTWARE, strlen(EXIF_DEF_SOFTWARE));
 
-    copyAttribute(mExifAttributes.exif_version, sizeof(mExifAttributes.exif_version),
+    copyAttribute(mDefaultAttributes.exif_version, sizeof(mDefaultAttributes.exif_version),
                   EXIF_DEF_EXIF_VERSION, strlen(EXIF_DEF_EXIF_VERSION));
 
-    copyAttribute(mExifAttributes.flashpix_version, sizeof(mExifAttributes.flashpix_version),
-                  EXIF_DEF_FLASHPIXVERSION, strlen(EXIF_DEF_FLASHPIXVERSION));
+    copyAttribute(mDefaultAttributes.flashpix_version,
+                  sizeof(mDefaultAttributes.flashpix_version), EXIF_DEF_FLASHPIXVERSION,
+                  strlen(EXIF_DEF_FLASHPIXVERSION));
 
     // initially, set default flash
-    mExifAttributes.flash = EXIF_DEF_FLASH;
+    mDefaultAttributes.flash = EXIF_DEF_FLASH;
 
     // normally it is sRGB, 1 means sRGB. FFFF.H means uncalibrated
-    mExifAttributes.color_space = EXIF_DEF_COLOR_SPACE;
+    mDefaultAttributes.color_space = EXIF_DEF_COLOR_SPACE;
 
     // the number of pixels per ResolutionUnit in the w or h direction
     // 72 means the image resolution is unknown
-    mExifAttributes.x_resolution.num = EXIF_DEF_RESOLUTION_NUM;
-    mExifAttributes.x_resolution.den = EXIF_DEF_RESOLUTION_DEN;
-    mExifAttributes.y_resolution.num = mExifAttributes.x_resolution.num;
-    mExifAttributes.y_resolution.den = mExifAttributes.x_resolution.den;
+    mDefaultAttributes.x_resolution.num = EXIF_DEF_RESOLUTION_NUM;
+    mDefaultAttributes.x_resolution.den = EXIF_DEF_RESOLUTION_DEN;
+    mDefaultAttributes.y_resolution.num = mDefaultAttributes.x_resolution.num;
+    mDefaultAttributes.y_resolution.den = mDefaultAttributes.x_resolution.den;
     // resolution unit, 2 means inch
-    mExifAttributes.resolution_unit = EXIF_DEF_RESOLUTION_UNIT;
+    mDefaultAttributes.resolution_unit = EXIF_DEF_RESOLUTION_UNIT;
     // when thumbnail uses JPEG compression, this tag 103H's value is set to 6
-    mExifAttributes.compression_scheme = EXIF_DEF_COMPRESSION;
+    mDefaultAttributes.compression_scheme = EXIF_DEF_COMPRESSION;
 
     // the TIFF default is 1 (centered)
-    mExifAttributes.ycbcr_positioning = EXIF_DEF_YCBCR_POSITIONING;
+    mDefaultAttributes.ycbcr_positioning = EXIF_DEF_YCBCR_POSITIONING;
 
     // Clear the Intel 3A Makernote information
-    mExifAttributes.makerNoteData = mMakernoteSection;
-    mExifAttributes.makerNoteDataSize = 0;
-    mExifAttributes.makernoteToApp2 = ENABLE_APP2_MARKER;
+    mDefaultAttributes.makerNoteData = mMakernoteSection;
+    mDefaultAttributes.makerNoteDataSize = 0;
+    mDefaultAttributes.makernoteToApp2 = ENABLE_APP2_MARKER;
+}
 
+void EXIFMaker::clear() {
+    LOG1("@%s", __func__);
+    // Reset all the attributes to the common values
+    mExifAttributes = mDefaultAttributes;
     mInitialized = false;
 }
 
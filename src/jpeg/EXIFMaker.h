@@ -53,6 +53,8 @@ class EXIFMaker {
  private:  // member variables
     ExifCreater mEncoder;
     exif_attribute_t mExifAttributes;
+    // The attributes which don't change in the session, restored by clear() for each picture
+    exif_attribute_t mDefaultAttributes;
     size_t mExifSize;
     bool mInitialized;
     unsigned char* mMakernoteSection;
@@ -66,6 +68,7 @@ class EXIFMaker {
  private:  // Methods
     void copyAttribute(uint8_t* dst, size_t dstSize, const char* src, size_t srcLength);
 
+    void initDefaultAttributes();
     void clear();
 };
 
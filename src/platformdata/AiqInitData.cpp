@@ -19,8 +19,12 @@
 #include "AiqInitData.h"
 
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
+#include <map>
 #include <set>
 #include <unordered_map>
 
@@ -36,10 +40,69 @@ namespace icamera {
 
 static const char* CAMERA_AIQD_PATH = "/run/camera/";
 
-AiqData::AiqData(const std::string& fileName, int maxSize) : mDataPtr(nullptr) {
+struct AiqData::MappedFile {
+    void* addr;
+    size_t size;
+
+    MappedFile(void* mapAddr, size_t mapSize) : addr(mapAddr), size(mapSize) {}
+    ~MappedFile() { munmap(addr, size); }
+};
+
+std::shared_ptr<AiqData::MappedFile> AiqData::mapFile(const std::string& fileName) {
+    static Mutex sMapLock;
+    // Keep weak references only, the file is unmapped when no AiqData uses it
+    static std::map<std::string, std::weak_ptr<MappedFile>> sMappedFiles;
+
+    AutoMutex l(sMapLock);
+    // Drop the entries of the files unmapped since the last call
+    for (auto it = sMappedFiles.begin(); it != sMappedFiles.end();) {
+        if (it->second.expired()) {
+            it = sMappedFiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // The file may still be unmapped by another thread after the check above
+    std::shared_ptr<MappedFile> mappedFile;
+    auto it = sMappedFiles.find(fileName);
+    if (it != sMappedFiles.end()) mappedFile = it->second.lock();
+    if (mappedFile) return mappedFile;
+
+    int fd = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    CheckWarning(fd < 0, nullptr, "Failed to open file %s, error %s", fileName.c_str(),
+                 strerror(errno));
+
+    struct stat fileStat;
+    CLEAR(fileStat);
+    void* addr = MAP_FAILED;
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+        addr = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    CheckWarning(addr == MAP_FAILED, nullptr, "Failed to map file %s, error %s",
+                 fileName.c_str(), strerror(errno));
+
+    mappedFile = std::make_shared<MappedFile>(addr, fileStat.st_size);
+    sMappedFiles[fileName] = mappedFile;
+    LOG1("%s, file %s, size %zu", __func__, fileName.c_str(), mappedFile->size);
+
+    return mappedFile;
+}
+
+AiqData::AiqData(const std::string& fileName, int maxSize, bool readOnly) : mDataPtr(nullptr) {
     LOG1("%s, file name %s", __func__, fileName.c_str());
 
     mFileName = fileName;
+    CLEAR(mData);
+    if (readOnly && maxSize <= 0) {
+        mMappedFile = mapFile(fileName);
+        if (mMappedFile) {
+            mData.data = mMappedFile->addr;
+            mData.size = mMappedFile->size;
+            return;
+        }
+    }
     loadFile(fileName, &mData, maxSize);
 }
 
@@ -48,20 +111,20 @@ AiqData::~AiqData() {
 }
 
 ia_binary_data* AiqData::getData() {
-    return mDataPtr ? &mData : nullptr;
+    return (mDataPtr || mMappedFile) ? &mData : nullptr;
 }
 
 void AiqData::saveData(const ia_binary_data& data) {
     LOG1("%s", __func__);
 
+    // The mapped file is read only, save the data to heap
+    mMappedFile.reset();
     if (!mDataPtr || data.size != mData.size) {
         mDataPtr.reset(new char[data.size]);
         mData.size = data.size;
         mData.data = mDataPtr.get();
     }
     MEMCPY_S(mData.data, mData.size, data.data, data.size);
-
-    saveDataToFile(mFileName, &mData);
 }
 
 void AiqData::loadFile(const std::string& fileName, ia_binary_data* data, int maxSize) {
@@ -104,22 +167,29 @@ void AiqData::saveDataToFile(const std::string& fileName, const ia_binary_data*
     LOG1("%s", __func__);
     CheckAndLogError(data == nullptr, VOID_VALUE, "data is nullptr");
 
+    std::string tmpFileName = fileName + ".tmp";
+
     // Open file
-    FILE* fp = fopen(fileName.c_str(), "wb");
-    CheckWarning(fp == nullptr, VOID_VALUE, "Failed to open file %s, error %s", fileName.c_str(),
-                 strerror(errno));
+    FILE* fp = fopen(tmpFileName.c_str(), "wb");
+    CheckWarning(fp == nullptr, VOID_VALUE, "Failed to open file %s, error %s",
+                 tmpFileName.c_str(), strerror(errno));
 
     // Write data to file
     size_t writeSize = fwrite(data->data, 1, data->size, fp);
-    if (writeSize != data->size) {
-        LOGW("Failed to write data %s, error %s", fileName.c_str(), strerror(errno));
+    if (writeSize != data->size || fflush(fp) != 0 || fsync(fileno(fp)) != 0) {
+        LOGW("Failed to write data %s, error %s", tmpFileName.c_str(), strerror(errno));
         fclose(fp);
+        remove(tmpFileName.c_str());
         return;
     }
-
-    fflush(fp);
     fclose(fp);
 
+    if (rename(tmpFileName.c_str(), fileName.c_str()) != 0) {
+        LOGW("Failed to rename %s, error %s", tmpFileName.c_str(), strerror(errno));
+        remove(tmpFileName.c_str());
+        return;
+    }
+
     LOG1("%s, file %s, size %d", __func__, fileName.c_str(), data->size);
 }
 
@@ -129,7 +199,8 @@ AiqInitData::AiqInitData(const std::string& sensorName, const std::string& camCf
         : mSensorName(sensorName),
           mMaxNvmSize(maxNvmSize),
           mTuningCfg(tuningCfg),
-          mNvm(nullptr) {
+          mNvm(nullptr),
+          mAiqdWriterExit(false) {
     LOG1("@%s, mMaxNvmSize:%d", __func__, mMaxNvmSize);
 
     std::set<std::string> aiqbNameFromModuleInfo;
@@ -183,7 +254,9 @@ AiqInitData::AiqInitData(const std::string& sensorName, const std::string& camCf
             return;
         }
 
-        if (mCpf.find(cfg.tuningMode) == mCpf.end()) mCpf[cfg.tuningMode] = new AiqData(aiqbName);
+        if (mCpfFileNames.find(cfg.tuningMode) == mCpfFileNames.end()) {
+            mCpfFileNames[cfg.tuningMode] = aiqbName;
+        }
     }
 
     mMkn = std::unique_ptr<MakerNote>(new MakerNote);
@@ -192,7 +265,17 @@ AiqInitData::AiqInitData(const std::string& sensorName, const std::string& camCf
 AiqInitData::~AiqInitData() {
     LOG1("@%s", __func__);
 
-    for (auto aiqb : mCpf) {
+    // Let the writer finish the pending aiqd before exiting
+    if (mAiqdWriter) {
+        {
+            AutoMutex l(mAiqdWriteLock);
+            mAiqdWriterExit = true;
+            mAiqdWriteSignal.signal();
+        }
+        mAiqdWriter->join();
+    }
+
+    for (auto aiqb : mCpfFiles) {
         delete aiqb.second;
     }
 
@@ -240,10 +323,23 @@ int AiqInitData::getCpf(TuningMode mode, ia_binary_data* cpfData) {
     LOG1("@%s mode = %d", __func__, mode);
     CheckAndLogError(cpfData == nullptr, BAD_VALUE, "@%s, cpfData is nullptr", __func__);
 
-    CheckAndLogError(mCpf.find(mode) == mCpf.end(), NO_INIT, "@%s, no aiqb, mode = %d", __func__,
-                     mode);
-
-    AiqData* cpf = mCpf[mode];
+    AiqData* cpf = nullptr;
+    {
+        AutoMutex l(mCpfLock);
+        auto it = mCpf.find(mode);
+        if (it != mCpf.end()) {
+            cpf = it->second;
+        } else {
+            auto fileName = mCpfFileNames.find(mode);
+            CheckAndLogError(fileName == mCpfFileNames.end(), NO_INIT,
+                             "@%s, no aiqb, mode = %d", __func__, mode);
+
+            AiqData*& fileData = mCpfFiles[fileName->second];
+            if (!fileData) fileData = new AiqData(fileName->second, -1, true);
+            cpf = fileData;
+            mCpf[mode] = cpf;
+        }
+    }
     CheckAndLogError(cpf == nullptr, NO_INIT, "@%s, cpf is nullptr", __func__);
 
     auto dataPtr = cpf->getData();
@@ -306,18 +402,48 @@ ia_binary_data* AiqInitData::getAiqd(TuningMode mode) {
 }
 
 void AiqInitData::saveAiqd(TuningMode mode, const ia_binary_data& data) {
+    CheckAndLogError(!data.data || data.size == 0, VOID_VALUE, "@%s, aiqd data is empty",
+                     __func__);
+
+    std::string fileName = getAiqdFileNameWithPath(mode);
     if (mAiqd.find(mode) == mAiqd.end()) {
-        mAiqd[mode] = new AiqData(getAiqdFileNameWithPath(mode));
+        mAiqd[mode] = new AiqData(fileName);
     }
 
     AiqData* aiqd = mAiqd[mode];
     CheckAndLogError(!aiqd, VOID_VALUE, "@%s, aiqd is nullptr", __func__);
 
+    // Keep the latest aiqd in memory for the next use, and write it to file in background
     aiqd->saveData(data);
 
-    // After saved aiqd data, the aiqd data should be reloaded next time.
-    delete aiqd;
-    mAiqd.erase(mode);
+    const uint8_t* dataPtr = static_cast<const uint8_t*>(data.data);
+    AutoMutex l(mAiqdWriteLock);
+    mPendingAiqd[fileName].assign(dataPtr, dataPtr + data.size);
+    if (!mAiqdWriter) {
+        mAiqdWriter = std::unique_ptr<AiqdWriter>(new AiqdWriter(this));
+        mAiqdWriter->run("AiqdWriter");
+    }
+    mAiqdWriteSignal.signal();
+}
+
+bool AiqInitData::writePendingAiqd() {
+    std::unordered_map<std::string, std::vector<uint8_t>> pendingAiqd;
+    {
+        ConditionLock lock(mAiqdWriteLock);
+        while (mPendingAiqd.empty() && !mAiqdWriterExit) {
+            mAiqdWriteSignal.wait(lock);
+        }
+        if (mPendingAiqd.empty()) return false;
+
+        pendingAiqd.swap(mPendingAiqd);
+    }
+
+    for (auto& aiqd : pendingAiqd) {
+        ia_binary_data data = {aiqd.second.data(), static_cast<unsigned int>(aiqd.second.size())};
+        AiqData::saveDataToFile(aiqd.first, &data);
+    }
+
+    return true;
 }
 
 int AiqInitData::initMakernote(int cameraId, TuningMode tuningMode) {
@@ -23,6 +23,7 @@
 
 #include "CameraMetadata.h"
 #include "iutils/Errors.h"
+#include "iutils/Thread.h"
 #include "iutils/Utils.h"
 
 #include "MakerNote.h"
@@ -31,19 +32,33 @@ namespace icamera {
 
 class AiqData {
  public:
-    explicit AiqData(const std::string& fileName, int maxSize = -1);
+    /**
+     * The read only data (aiqb) is mapped from the file instead of being read into heap,
+     * and the mapping is shared by all AiqData of the same file in the process.
+     */
+    explicit AiqData(const std::string& fileName, int maxSize = -1, bool readOnly = false);
     ~AiqData();
 
     ia_binary_data* getData();
+    // Update the data in memory only, the caller is responsible for writing it to file
     void saveData(const ia_binary_data& data);
 
     void loadFile(const std::string& fileName, ia_binary_data* data, int maxSize);
-    void saveDataToFile(const std::string& fileName, const ia_binary_data* data);
+    /**
+     * Write the data to a temporary file, sync it and rename it to fileName, so that the
+     * file is either the old one or the new one completely even if the writing is broken.
+     */
+    static void saveDataToFile(const std::string& fileName, const ia_binary_data* data);
+
+ private:
+    struct MappedFile;
+    static std::shared_ptr<MappedFile> mapFile(const std::string& fileName);
 
  private:
     std::string mFileName;
     ia_binary_data mData;
     std::unique_ptr<char[]> mDataPtr;
+    std::shared_ptr<MappedFile> mMappedFile;
 
  private:
     DISALLOW_COPY_AND_ASSIGN(AiqData);
@@ -81,13 +96,28 @@ class AiqInitData {
     std::string getAiqdFileNameWithPath(TuningMode mode);
     int findConfigFile(const std::string& camCfgDir, std::string* cpfPathName);
 
+ private:
+    class AiqdWriter : public Thread {
+     public:
+        explicit AiqdWriter(AiqInitData* initData) : mInitData(initData) {}
+        virtual bool threadLoop() { return mInitData->writePendingAiqd(); }
+
+     private:
+        AiqInitData* mInitData;
+    };
+
+    bool writePendingAiqd();
+
  private:
     std::string mSensorName;
     std::string mNvmPath;
     int mMaxNvmSize;
     std::vector<TuningConfig> mTuningCfg;
 
-    // cpf
+    // cpf, the aiqb files are loaded at the first use, and shared by the tuning modes using it
+    Mutex mCpfLock;
+    std::unordered_map<TuningMode, std::string> mCpfFileNames;
+    std::unordered_map<std::string, AiqData*> mCpfFiles;
     std::unordered_map<TuningMode, AiqData*> mCpf;
 
     // nvm
@@ -95,6 +125,12 @@ class AiqInitData {
 
     // aiqd
     std::unordered_map<TuningMode, AiqData*> mAiqd;
+    // The aiqd files are written by mAiqdWriter, only the latest data of each file is kept
+    Mutex mAiqdWriteLock;
+    Condition mAiqdWriteSignal;
+    std::unordered_map<std::string, std::vector<uint8_t>> mPendingAiqd;
+    bool mAiqdWriterExit;
+    std::unique_ptr<AiqdWriter> mAiqdWriter;
 
     // makernote
     std::unique_ptr<MakerNote> mMkn;
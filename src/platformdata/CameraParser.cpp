@@ -292,6 +292,10 @@ void CameraParser::handleCommon(CameraParser* profiles, const char* name, const
         cfg->isTnrParamForceUpdate = strcmp(atts[1], "true") == 0;
     } else if (strcmp(name, "tnrGlobalProtection") == 0) {
         cfg->useTnrGlobalProtection = strcmp(atts[1], "true") == 0;
+    } else if (strcmp(name, "useCpuTnr") == 0) {
+        cfg->useCpuTnr = strcmp(atts[1], "true") == 0;
+    } else if (strcmp(name, "preloadAllTuning") == 0) {
+        cfg->preloadAllTuning = strcmp(atts[1], "true") == 0;
     } else if (strcmp(name, "videoStreamNum") == 0) {
         int val = atoi(atts[1]);
         cfg->videoStreamNum = val > 0 ? val : DEFAULT_VIDEO_STREAM_NUM;
@@ -192,6 +192,8 @@ struct CommonConfig {
     bool isStillTnrPrior;
     bool isTnrParamForceUpdate;
     bool useTnrGlobalProtection;
+    bool useCpuTnr;
+    bool preloadAllTuning;
     int cameraNumber;
     int videoStreamNum;
     bool supportIspTuningUpdate;
@@ -206,6 +208,8 @@ struct CommonConfig {
         isStillTnrPrior = false;
         isTnrParamForceUpdate = false;
         useTnrGlobalProtection = true;
+        useCpuTnr = false;
+        preloadAllTuning = false;
         cameraNumber = -1;
         videoStreamNum = DEFAULT_VIDEO_STREAM_NUM;
         supportIspTuningUpdate = false;
@@ -21,7 +21,10 @@
 #include <math.h>
 #include <sys/sysinfo.h>
 
+#include <algorithm>
 #include <memory>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "CameraParser.h"
@@ -35,25 +38,34 @@ using std::string;
 using std::vector;
 
 namespace icamera {
-PlatformData* PlatformData::sInstance = nullptr;
+// Max threads to load the aiqb files at init, the loading is bound by the storage
+#define MAX_TUNING_LOAD_THREADS 4
+
+std::atomic<PlatformData*> PlatformData::sInstance(nullptr);
 Mutex PlatformData::sLock;
 
 PlatformData* PlatformData::getInstance() {
+    // The static config isn't changed after init, so the getters only need a plain load here.
+    PlatformData* instance = sInstance.load(std::memory_order_acquire);
+    if (instance) return instance;
+
     AutoMutex lock(sLock);
-    if (sInstance == nullptr) {
-        sInstance = new PlatformData();
+    instance = sInstance.load(std::memory_order_relaxed);
+    if (instance == nullptr) {
+        instance = new PlatformData();
+        sInstance.store(instance, std::memory_order_release);
     }
 
-    return sInstance;
+    return instance;
 }
 
 void PlatformData::releaseInstance() {
     AutoMutex lock(sLock);
     LOG1("@%s", __func__);
 
-    if (sInstance) {
-        delete sInstance;
-        sInstance = nullptr;
+    PlatformData* instance = sInstance.exchange(nullptr, std::memory_order_acq_rel);
+    if (instance) {
+        delete instance;
     }
 }
 
@@ -93,13 +105,17 @@ int PlatformData::init() {
 
     StaticCfg* staticCfg = &(getInstance()->mStaticCfg);
     for (size_t i = 0; i < staticCfg->mCameras.size(); i++) {
-        const std::string& camModuleName = staticCfg->mCameras[i].mCamModuleName;
         AiqInitData* aiqInitData = new AiqInitData(
             staticCfg->mCameras[i].sensorName, getCameraCfgPath(),
             staticCfg->mCameras[i].mSupportedTuningConfig, staticCfg->mCameras[i].mNvmDirectory,
-            staticCfg->mCameras[i].mMaxNvmDataSize, camModuleName, i);
+            staticCfg->mCameras[i].mMaxNvmDataSize, staticCfg->mCameras[i].mCamModuleName, i);
         getInstance()->mAiqInitData.push_back(aiqInitData);
+    }
+
+    preloadTuningData();
 
+    for (size_t i = 0; i < staticCfg->mCameras.size(); i++) {
+        const std::string& camModuleName = staticCfg->mCameras[i].mCamModuleName;
         staticCfg->getModuleInfoFromCmc(i);
 
         // Overwrite staticCfg with CameraModuleInfo in sensor xml
@@ -209,6 +225,44 @@ void PlatformData::parseGraphFromXmlFile() {
     }
 }
 
+/**
+ * Load the aiqb files needed at init in parallel, the cameras are independent.
+ * Only the default tuning mode is needed for the static capabilities, others are loaded at
+ * the first configure unless preloadAllTuning is set.
+ */
+void PlatformData::preloadTuningData() {
+    std::vector<std::pair<int, TuningMode>> jobs;
+    const StaticCfg& staticCfg = getInstance()->mStaticCfg;
+    for (size_t i = 0; i < staticCfg.mCameras.size(); i++) {
+        const std::vector<TuningConfig>& tuningCfg = staticCfg.mCameras[i].mSupportedTuningConfig;
+        if (tuningCfg.empty()) continue;
+
+        size_t count = isPreloadAllTuning() ? tuningCfg.size() : 1;
+        for (size_t j = 0; j < count; j++) {
+            jobs.push_back(std::make_pair(i, tuningCfg[j].tuningMode));
+        }
+    }
+
+    std::atomic<size_t> nextJob(0);
+    auto loadJobs = [&jobs, &nextJob]() {
+        for (size_t job = nextJob++; job < jobs.size(); job = nextJob++) {
+            ia_binary_data cpfData;
+            getCpf(jobs[job].first, jobs[job].second, &cpfData);
+        }
+    };
+
+    size_t workerCount = std::min(jobs.size(), static_cast<size_t>(MAX_TUNING_LOAD_THREADS));
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < workerCount; i++) {
+        workers.push_back(std::thread(loadJobs));
+    }
+    loadJobs();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    LOG1("%s, %zu aiqb loaded by %zu threads", __func__, jobs.size(), workerCount);
+}
+
 int PlatformData::queryGraphSettings(int cameraId, const stream_config_t* streamList) {
     if (PlatformData::getGraphConfigNodes(cameraId)) {
         IGraphConfigManager* gcInstance = IGraphConfigManager::getInstance(cameraId);
@@ -289,6 +343,8 @@ int PlatformData::getEdgeNrSetting(int cameraId, float totalGain, float hdrRatio
 }
 
 void PlatformData::releaseGraphConfigNodes() {
+    // The cached graph configs refer to the graph nodes
+    IGraphConfigManager::releaseGraphConfigCache();
     std::shared_ptr<GraphConfig> graphConfig = std::make_shared<GraphConfig>();
     graphConfig->releaseGraphNodes();
     for (size_t i = 0; i < mStaticCfg.mCameras.size(); ++i) {
@@ -1928,6 +1984,14 @@ bool PlatformData::isTnrParamForceUpdate() {
     return getInstance()->mStaticCfg.mCommonConfig.isTnrParamForceUpdate;
 }
 
+bool PlatformData::isCpuTnrEnabled() {
+    return getInstance()->mStaticCfg.mCommonConfig.useCpuTnr;
+}
+
+bool PlatformData::isPreloadAllTuning() {
+    return getInstance()->mStaticCfg.mCommonConfig.preloadAllTuning;
+}
+
 int PlatformData::getTnrExtraFrameCount(int cameraId) {
     return getInstance()->mStaticCfg.mCameras[cameraId].mTnrExtraFrameNum;
 }
@@ -24,6 +24,7 @@
 #include <v4l2_device.h>
 #endif
 
+#include <atomic>
 #include <map>
 #include <string>
 #include <unordered_map>
@@ -389,7 +390,7 @@ class PlatformData {
      *
      * Note: this is implemented in PlatformFactory.cpp
      */
-    static PlatformData* sInstance;
+    static std::atomic<PlatformData*> sInstance;
     static Mutex sLock;
     static PlatformData* getInstance();
 
@@ -438,6 +439,7 @@ class PlatformData {
      * Parse graph descriptor and settings from configuration files.
      */
     static void parseGraphFromXmlFile();
+    static void preloadTuningData();
 
     /**
      * Query GraphSettings
@@ -1726,6 +1728,16 @@ class PlatformData {
      */
     static bool isTnrParamForceUpdate();
 
+    /**
+     * Check if tnr runs on CPU instead of GPU
+     */
+    static bool isCpuTnrEnabled();
+
+    /**
+     * Check if the aiqb files of all tuning modes are loaded at init, instead of at the first use
+     */
+    static bool isPreloadAllTuning();
+
     /**
      * the extra frame count for still stream
      */
@@ -23,78 +23,102 @@
 #include "iutils/CameraLog.h"
 
 namespace icamera {
-PnpDebugControl* PnpDebugControl::sInstance = nullptr;
+std::atomic<PnpDebugControl*> PnpDebugControl::sInstance(nullptr);
 Mutex PnpDebugControl::sLock;
 
 PnpDebugControl* PnpDebugControl::getInstance() {
+    PnpDebugControl* instance = sInstance.load(std::memory_order_acquire);
+    if (instance) return instance;
+
     AutoMutex lock(sLock);
-    if (sInstance == nullptr) {
-        sInstance = new PnpDebugControl();
+    instance = sInstance.load(std::memory_order_relaxed);
+    if (instance == nullptr) {
+        instance = new PnpDebugControl();
+        sInstance.store(instance, std::memory_order_release);
     }
 
-    return sInstance;
+    return instance;
 }
 
 void PnpDebugControl::releaseInstance() {
     AutoMutex lock(sLock);
 
-    if (sInstance) {
-        delete sInstance;
-        sInstance = nullptr;
+    PnpDebugControl* instance = sInstance.exchange(nullptr, std::memory_order_acq_rel);
+    if (instance) {
+        delete instance;
     }
 }
 
+const PnpDebugControl::StaticCfg* PnpDebugControl::getConfig() {
+    return getInstance()->mStaticCfg.load(std::memory_order_acquire);
+}
+
 void PnpDebugControl::updateConfig() {
-    PnpDebugParser PnpDebugParser(&(getInstance()->mStaticCfg));
+    // Parse into a new snapshot and publish it, the getters never see a half-parsed config.
+    StaticCfg* cfg = new StaticCfg();
+    PnpDebugParser PnpDebugParser(cfg);
+
+    PnpDebugControl* instance = getInstance();
+    AutoMutex lock(sLock);
+    StaticCfg* oldCfg = instance->mStaticCfg.exchange(cfg, std::memory_order_acq_rel);
+    // The old snapshot may still be read by other threads, release it with the instance.
+    instance->mRetiredCfgs.push_back(std::unique_ptr<StaticCfg>(oldCfg));
+}
+
+PnpDebugControl::PnpDebugControl() : mStaticCfg(nullptr) {
+    StaticCfg* cfg = new StaticCfg();
+    PnpDebugParser PnpDebugParser(cfg);
+    mStaticCfg.store(cfg, std::memory_order_release);
 }
 
-PnpDebugControl::PnpDebugControl() {
-    PnpDebugParser PnpDebugParser(&mStaticCfg);
+PnpDebugControl::~PnpDebugControl() {
+    delete mStaticCfg.load(std::memory_order_relaxed);
 }
 
 bool PnpDebugControl::useMockAAL() {
-    return getInstance()->mStaticCfg.useMockAAL;
+    return getConfig()->useMockAAL;
 }
 
 float PnpDebugControl::pnpMockFps() {
-    return getInstance()->mStaticCfg.pnpMockFps;
+    return getConfig()->pnpMockFps;
 }
 
 bool PnpDebugControl::isBypass3A() {
-    return getInstance()->mStaticCfg.isBypass3A;
+    return getConfig()->isBypass3A;
 }
 
 bool PnpDebugControl::isBypassPAL() {
-    return getInstance()->mStaticCfg.isBypassPAL;
+    return getConfig()->isBypassPAL;
 }
 
 bool PnpDebugControl::isBypassPG() {
-    return getInstance()->mStaticCfg.isBypassPG;
+    return getConfig()->isBypassPG;
 }
 
 bool PnpDebugControl::isFaceDisabled() {
-    return getInstance()->mStaticCfg.isFaceDisabled;
+    return getConfig()->isFaceDisabled;
 }
 
 bool PnpDebugControl::isFaceAeDisabled() {
-    return getInstance()->mStaticCfg.isFaceDisabled ? true :
-                                                      getInstance()->mStaticCfg.isFaceAeDisabled;
+    const StaticCfg* cfg = getConfig();
+    return cfg->isFaceDisabled ? true : cfg->isFaceAeDisabled;
 }
 
 bool PnpDebugControl::isBypassFDAlgo() {
-    return !getInstance()->mStaticCfg.isFaceDisabled && getInstance()->mStaticCfg.isBypassFDAlgo;
+    const StaticCfg* cfg = getConfig();
+    return !cfg->isFaceDisabled && cfg->isBypassFDAlgo;
 }
 
 bool PnpDebugControl::isBypassISys() {
-    return getInstance()->mStaticCfg.isBypassISys;
+    return getConfig()->isBypassISys;
 }
 
 bool PnpDebugControl::useMockHal() {
-    return getInstance()->mStaticCfg.useMockHal;
+    return getConfig()->useMockHal;
 }
 
 bool PnpDebugControl::isBypassP2p() {
-    return getInstance()->mStaticCfg.isBypassP2p;
+    return getConfig()->isBypassP2p;
 }
 
 #define PNP_DEBUG_FILE_NAME "pnp_profiles.xml"
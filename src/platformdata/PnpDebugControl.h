@@ -26,6 +26,10 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include "CameraTypes.h"
 #include "ParserBase.h"
 #include "PlatformData.h"
@@ -154,13 +158,16 @@ class PnpDebugControl {
 
  private:
     PnpDebugControl();
-    ~PnpDebugControl() {}
+    ~PnpDebugControl();
 
  private:
-    struct StaticCfg mStaticCfg;
-    static PnpDebugControl* sInstance;
+    // Current config snapshot, replaced as a whole by updateConfig()
+    std::atomic<StaticCfg*> mStaticCfg;
+    std::vector<std::unique_ptr<StaticCfg>> mRetiredCfgs;  // Guarded by sLock
+    static std::atomic<PnpDebugControl*> sInstance;
     static Mutex sLock;
     static PnpDebugControl* getInstance();
+    static const StaticCfg* getConfig();
 };
 
 class PnpDebugParser : public ParserBase {
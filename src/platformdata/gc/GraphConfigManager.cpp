@@ -18,6 +18,9 @@
 
 #include "src/platformdata/gc/GraphConfigManager.h"
 
+#include <list>
+#include <sstream>
+
 #include "PlatformData.h"
 #include "iutils/CameraLog.h"
 #include "iutils/Utils.h"
@@ -26,6 +29,19 @@ using std::map;
 using std::vector;
 
 namespace icamera {
+// The configured result of one stream configuration
+struct GraphConfigCacheEntry {
+    std::string key;
+    std::vector<HalStream*> halStreamVec;  // Owned, the graph config pipes refer to them
+    std::map<ConfigMode, std::shared_ptr<GraphConfig> > graphConfigMap;
+    int mcId;
+};
+
+static const size_t kGraphConfigCacheSize = 4;
+static Mutex sGraphConfigCacheLock;
+// Key: camera id, the most recently used entry is at the front of the list
+static map<int, std::list<GraphConfigCacheEntry> > sGraphConfigCaches;
+
 GraphConfigManager::GraphConfigManager(int32_t cameraId)
         : mGcConfigured(false),
           mCameraId(cameraId),
@@ -103,6 +119,63 @@ int GraphConfigManager::createHalStreamVector(ConfigMode configMode,
     return OK;
 }
 
+/*
+ * The key covers everything which the graph config result depends on: the operation mode,
+ * the sorted hal streams and the sensor mode.
+ */
+std::string GraphConfigManager::getGraphConfigCacheKey(const stream_config_t* streamList,
+                                                       const std::vector<HalStream*>& halStreamVec) {
+    std::ostringstream key;
+    key << streamList->operation_mode;
+    if (PlatformData::isBinningModeSupport(mCameraId)) {
+        key << ":" << PlatformData::getSensorMode(mCameraId);
+    }
+
+    for (const auto& halStream : halStreamVec) {
+        key << ":" << halStream->width() << "x" << halStream->height() << ","
+            << halStream->format() << "," << halStream->streamId() << "," << halStream->useCase();
+    }
+
+    return key.str();
+}
+
+bool GraphConfigManager::loadGraphConfigCache(const std::string& key) {
+    AutoMutex l(sGraphConfigCacheLock);
+    std::list<GraphConfigCacheEntry>& cache = sGraphConfigCaches[mCameraId];
+    for (auto it = cache.begin(); it != cache.end(); ++it) {
+        if (it->key != key) continue;
+
+        cache.splice(cache.begin(), cache, it);
+        mGraphConfigMap = cache.front().graphConfigMap;
+        mMcId = cache.front().mcId;
+        LOG1("<id%d>%s, reuse the graph config of %s", mCameraId, __func__, key.c_str());
+        return true;
+    }
+
+    return false;
+}
+
+/*
+ * The cache entry takes over the hal streams, because the graph config pipes refer to them.
+ */
+void GraphConfigManager::saveGraphConfigCache(const std::string& key) {
+    AutoMutex l(sGraphConfigCacheLock);
+    std::list<GraphConfigCacheEntry>& cache = sGraphConfigCaches[mCameraId];
+    if (cache.size() >= kGraphConfigCacheSize) {
+        GraphConfigCacheEntry& oldest = cache.back();
+        oldest.graphConfigMap.clear();
+        releaseHalStream(&oldest.halStreamVec);
+        cache.pop_back();
+    }
+
+    cache.push_front(GraphConfigCacheEntry());
+    GraphConfigCacheEntry& entry = cache.front();
+    entry.key = key;
+    entry.halStreamVec.swap(mHalStreamVec);
+    entry.graphConfigMap = mGraphConfigMap;
+    entry.mcId = mMcId;
+}
+
 /*
  * Query graph setting according to streamList
  */
@@ -162,6 +235,13 @@ status_t GraphConfigManager::configStreams(const stream_config_t* streamList) {
     mGraphConfigMap.clear();
     mMcId = -1;
 
+    std::string cacheKey = getGraphConfigCacheKey(streamList, mHalStreamVec);
+    if (loadGraphConfigCache(cacheKey)) {
+        releaseHalStream(&mHalStreamVec);
+        mGcConfigured = true;
+        return OK;
+    }
+
     for (auto mode : configModes) {
         LOG1("Mapping the operationMode %d to ConfigMode %d", streamList->operation_mode, mode);
 
@@ -179,6 +259,7 @@ status_t GraphConfigManager::configStreams(const stream_config_t* streamList) {
         mGraphConfigMap[mode] = graphConfig;
     }
 
+    saveGraphConfigCache(cacheKey);
     mGcConfigured = true;
     return OK;
 }
@@ -221,4 +302,17 @@ void IGraphConfigManager::releaseInstance(int cameraId) {
         delete gcManager;
     }
 }
+
+void IGraphConfigManager::releaseGraphConfigCache() {
+    AutoMutex l(sGraphConfigCacheLock);
+    for (auto& cache : sGraphConfigCaches) {
+        for (auto& entry : cache.second) {
+            entry.graphConfigMap.clear();
+            for (auto& halStream : entry.halStreamVec) {
+                delete halStream;
+            }
+        }
+    }
+    sGraphConfigCaches.clear();
+}
 }  // namespace icamera
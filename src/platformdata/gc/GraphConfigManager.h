@@ -19,6 +19,7 @@
 #include <gcss.h>
 
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -51,6 +52,14 @@ namespace icamera {
  * Per each request, GraphConfigManager creates GraphConfig objects based
  * on request content. These objects are owned by GCM in a pool, and passed
  * around HAL via shared pointers.
+ *
+ * The GraphConfig objects of the latest stream configurations of each camera
+ * are kept in a LRU cache, so switching back to a known configuration doesn't
+ * search the graph settings again. The cache is not owned by the manager, it
+ * is kept when the camera is closed and released at HAL deinit.
+ * The configurations are not precomputed at init: the HAL doesn't know the
+ * stream combinations of the app, and building all the combinations that the
+ * graph settings can match would cost more than the configurations it saves.
  */
 class GraphConfigManager : public IGraphConfigManager {
  public:
@@ -73,6 +82,10 @@ class GraphConfigManager : public IGraphConfigManager {
 
     StreamUseCase getUseCaseFromStream(ConfigMode configMode, const stream_t& stream);
     void releaseHalStream(std::vector<HalStream*>* halStreamVec);
+    std::string getGraphConfigCacheKey(const stream_config_t* streamList,
+                                       const std::vector<HalStream*>& halStreamVec);
+    bool loadGraphConfigCache(const std::string& key);
+    void saveGraphConfigCache(const std::string& key);
 
     // Debuging helpers
     void dumpStreamConfig();
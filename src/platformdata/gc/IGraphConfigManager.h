@@ -35,6 +35,8 @@ class IGraphConfigManager {
     virtual bool isGcConfigured(void) = 0;
     static void releaseInstance(int cameraId);
     static IGraphConfigManager* getInstance(int cameraId);
+    // Release the graph configs cached for all cameras, they are kept across camera reopen
+    static void releaseGraphConfigCache();
 
  private:
     // Guard for singleton instance creation.
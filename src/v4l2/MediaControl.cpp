@@ -22,6 +22,8 @@
 #include <linux/v4l2-mediabus.h>
 #include <linux/videodev2.h>
 
+#include <iterator>
+#include <memory>
 #include <stack>
 #include <string>
 
@@ -127,7 +129,7 @@ void MediaControl::releaseInstance() {
     }
 }
 
-MediaControl::MediaControl(const char* devName) : mDevName(devName) {
+MediaControl::MediaControl(const char* devName) : mDevName(devName), mPipelineCached(false) {
     LOG1("@%s device: %s", __func__, devName);
 }
 
@@ -160,18 +162,20 @@ void MediaControl::clearEntities() {
         entity->links = nullptr;
         entity = mEntities.erase(entity);
     }
+    mEntityNameIndex.clear();
+    mEntityIdIndex.clear();
+
+    AutoMutex l(mLinkLock);
+    mPipelineCached = false;
+    mPadFormats.clear();
+    mPadSelections.clear();
 }
 
 MediaEntity* MediaControl::getEntityByName(const char* name) {
     CheckAndLogError(!name, nullptr, "Invalid Entity name");
 
-    for (auto& entity : mEntities) {
-        if (strcmp(name, entity.info.name) == 0) {
-            return &entity;
-        }
-    }
-
-    return nullptr;
+    auto index = mEntityNameIndex.find(name);
+    return index != mEntityNameIndex.end() ? &mEntities[index->second] : nullptr;
 }
 
 int MediaControl::getEntityIdByName(const char* name) {
@@ -185,12 +189,17 @@ int MediaControl::getEntityIdByName(const char* name) {
 
 int MediaControl::resetAllLinks() {
     LOG1("@%s", __func__);
+    AutoMutex l(mLinkLock);
+
+    // Only the enabled links need to be reset
+    int ret = refreshLinkFlags();
+    CheckAndLogError(ret < 0, ret, "Failed to get the link flags");
 
     for (auto& entity : mEntities) {
         for (uint32_t j = 0; j < entity.numLinks; j++) {
             MediaLink* link = &entity.links[j];
 
-            if (link->flags & MEDIA_LNK_FL_IMMUTABLE ||
+            if (link->flags & MEDIA_LNK_FL_IMMUTABLE || !(link->flags & MEDIA_LNK_FL_ENABLED) ||
                 link->source->entity->info.id != entity.info.id) {
                 continue;
             }
@@ -206,6 +215,7 @@ int MediaControl::resetAllLinks() {
 // VIRTUAL_CHANNEL_S
 int MediaControl::resetAllRoutes(int cameraId) {
     LOG1("<id%d> %s", cameraId, __func__);
+    AutoMutex l(mLinkLock);
 
     for (MediaEntity& entity : mEntities) {
         struct v4l2_subdev_route routes[entity.info.pads];
@@ -297,28 +307,41 @@ done:
     return ret;
 }
 
+MediaLink* MediaControl::findLink(uint32_t srcEntity, uint32_t srcPad, uint32_t sinkEntity,
+                                  uint32_t sinkPad) {
+    MediaEntity* entity = getEntityById(srcEntity);
+    if (!entity) return nullptr;
+
+    for (uint32_t j = 0; j < entity->numLinks; j++) {
+        MediaLink* link = &entity->links[j];
+
+        if ((link->source->entity->info.id == srcEntity) && (link->source->index == srcPad) &&
+            (link->sink->entity->info.id == sinkEntity) && (link->sink->index == sinkPad)) {
+            return link;
+        }
+    }
+
+    return nullptr;
+}
+
 int MediaControl::setupLink(uint32_t srcEntity, uint32_t srcPad, uint32_t sinkEntity,
                             uint32_t sinkPad, bool enable) {
     LOG1("@%s srcEntity %d srcPad %d sinkEntity %d sinkPad %d enable %d", __func__, srcEntity,
          srcPad, sinkEntity, sinkPad, enable);
 
-    for (auto& entity : mEntities) {
-        for (uint32_t j = 0; j < entity.numLinks; j++) {
-            MediaLink* link = &entity.links[j];
+    MediaLink* link = findLink(srcEntity, srcPad, sinkEntity, sinkPad);
+    if (!link) return -1;
 
-            if ((link->source->entity->info.id == srcEntity) && (link->source->index == srcPad) &&
-                (link->sink->entity->info.id == sinkEntity) && (link->sink->index == sinkPad)) {
-                if (enable)
-                    link->flags |= MEDIA_LNK_FL_ENABLED;
-                else
-                    link->flags &= ~MEDIA_LNK_FL_ENABLED;
+    // The link is already in the state
+    if (mPipelineCached && ((link->flags & MEDIA_LNK_FL_ENABLED) != 0) == enable) return 0;
 
-                return setupLink(link->source, link->sink, link->flags);
-            }
-        }
-    }
+    uint32_t flags = link->flags;
+    if (enable)
+        flags |= MEDIA_LNK_FL_ENABLED;
+    else
+        flags &= ~MEDIA_LNK_FL_ENABLED;
 
-    return -1;
+    return setupLink(link->source, link->sink, flags);
 }
 
 int MediaControl::openDevice() {
@@ -451,6 +474,8 @@ int MediaControl::enumEntities(int fd, media_device_info& devInfo) {
         entity.pads = new MediaPad[entity.info.pads];
         entity.links = new MediaLink[entity.maxLinks];
         getDevnameFromSysfs(&entity);
+        mEntityNameIndex[entity.info.name] = mEntities.size();
+        mEntityIdIndex[entity.info.id] = mEntities.size();
         mEntities.push_back(entity);
 
         /* Note: carefully to move the follow setting. It must be behind of
@@ -616,6 +641,49 @@ int MediaControl::enumLinks(int fd) {
     return ret;
 }
 
+int MediaControl::refreshLinkFlags() {
+    LOG1("@%s", __func__);
+    mPadFormats.clear();
+    mPadSelections.clear();
+
+    int fd = openDevice();
+    CheckAndLogError(fd < 0, fd, "Open device failed.");
+
+    SysCall* sc = SysCall::getInstance();
+    int ret = 0;
+    for (auto& entity : mEntities) {
+        if (entity.info.links == 0) continue;
+
+        media_links_enum links;
+        CLEAR(links);
+        std::unique_ptr<media_pad_desc[]> pads(new media_pad_desc[entity.info.pads]());
+        std::unique_ptr<media_link_desc[]> linkDescs(new media_link_desc[entity.info.links]());
+        links.entity = entity.info.id;
+        links.pads = pads.get();
+        links.links = linkDescs.get();
+
+        if (sc->ioctl(fd, MEDIA_IOC_ENUM_LINKS, &links) < 0) {
+            ret = -errno;
+            LOGE("Unable to enumerate links (%s).", strerror(errno));
+            break;
+        }
+
+        for (uint32_t i = 0; i < entity.info.links; ++i) {
+            const media_link_desc& desc = linkDescs[i];
+            MediaLink* link = findLink(desc.source.entity, desc.source.index, desc.sink.entity,
+                                       desc.sink.index);
+            if (!link) continue;
+
+            link->flags = desc.flags;
+            if (link->twin) link->twin->flags = desc.flags;
+        }
+    }
+    closeDevice(fd);
+
+    mPipelineCached = (ret == 0);
+    return ret;
+}
+
 MediaLink* MediaControl::entityAddLink(MediaEntity* entity) {
     if (entity->numLinks >= entity->maxLinks) {
         uint32_t maxLinks = entity->maxLinks * 2;
@@ -641,6 +709,11 @@ MediaEntity* MediaControl::getEntityById(uint32_t id) {
 
     id &= ~MEDIA_ENT_ID_FLAG_NEXT;
 
+    if (!next) {
+        auto index = mEntityIdIndex.find(id);
+        return index != mEntityIdIndex.end() ? &mEntities[index->second] : nullptr;
+    }
+
     for (uint32_t i = 0; i < mEntities.size(); i++) {
         if ((mEntities[i].info.id == id && !next) || (mEntities[0].info.id > id && next)) {
             return &mEntities[i];
@@ -755,6 +828,16 @@ int MediaControl::setFormat(int cameraId, const McFormat* format, int targetWidt
          format->pad, format->stream, mbusfmt.width, mbusfmt.height, targetWidth, targetHeight,
          CameraUtils::pixelCode2String(mbusfmt.code));
 
+    // The same format was set, and the links it was propagated to are unchanged
+    std::tuple<int, int, int> padKey(format->entity, format->pad, format->stream);
+    auto padFormat = mPadFormats.find(padKey);
+    if (mPipelineCached && padFormat != mPadFormats.end() &&
+        memcmp(&padFormat->second, &mbusfmt, sizeof(mbusfmt)) == 0) {
+        LOG1("format %s [%d:%d/%d] is already set", format->entityName.c_str(), format->entity,
+             format->pad, format->stream);
+        return 0;
+    }
+
     struct v4l2_subdev_format fmt = {};
     fmt.pad = format->pad;
     fmt.which = V4L2_SUBDEV_FORMAT_ACTIVE;
@@ -763,9 +846,12 @@ int MediaControl::setFormat(int cameraId, const McFormat* format, int targetWidt
     fmt.stream = format->stream;
     // VIRTUAL_CHANNEL_E
     ret = subDev->SetFormat(fmt);
+    if (ret < 0) mPadFormats.erase(padKey);
     CheckAndLogError(ret < 0, BAD_VALUE, "set format %s [%d:%d] [%dx%d] %s failed.",
                      format->entityName.c_str(), format->entity, format->pad, format->width,
                      format->height, CameraUtils::pixelCode2String(format->pixelCode));
+    if (!(pad->flags & MEDIA_PAD_FL_SOURCE)) dropResetPadCache(entity, format->pad, -1);
+    mPadFormats[padKey] = mbusfmt;
 
     mbusfmt = fmt.format;
 
@@ -786,6 +872,7 @@ int MediaControl::setFormat(int cameraId, const McFormat* format, int targetWidt
                 tmt.pad = link->sink->index;
                 tmt.which = V4L2_SUBDEV_FORMAT_ACTIVE;
                 subDev->SetFormat(tmt);
+                dropResetPadCache(link->sink->entity, link->sink->index, -1);
             }
         }
     }
@@ -793,6 +880,39 @@ int MediaControl::setFormat(int cameraId, const McFormat* format, int targetWidt
     return 0;
 }
 
+void MediaControl::dropResetPadCache(const MediaEntity* entity, int sinkPad, int target) {
+    int entityId = entity->info.id;
+    auto isSourcePad = [&](int pad) {
+        return pad >= 0 && pad < entity->info.pads &&
+               (entity->pads[pad].flags & MEDIA_PAD_FL_SOURCE);
+    };
+
+    for (auto it = mPadFormats.begin(); it != mPadFormats.end();) {
+        bool reset = false;
+        if (std::get<0>(it->first) == entityId) {
+            int pad = std::get<1>(it->first);
+            // The sink format may be set by the propagation from the linked source pad
+            reset = isSourcePad(pad) || (pad == sinkPad && target < 0);
+        }
+        it = reset ? mPadFormats.erase(it) : std::next(it);
+    }
+    for (auto it = mPadSelections.begin(); it != mPadSelections.end();) {
+        bool reset = false;
+        if (std::get<0>(it->first) == entityId) {
+            int pad = std::get<1>(it->first);
+            int selTarget = std::get<2>(it->first);
+            if (isSourcePad(pad)) {
+                reset = true;
+            } else if (pad == sinkPad) {
+                // The sink format resets the crop and compose, and the crop resets the compose
+                reset = target < 0 ||
+                        (target == V4L2_SEL_TGT_CROP && selTarget == V4L2_SEL_TGT_COMPOSE);
+            }
+        }
+        it = reset ? mPadSelections.erase(it) : std::next(it);
+    }
+}
+
 int MediaControl::setSelection(int cameraId, const McFormat* format, int targetWidth,
                                int targetHeight) {
     PERF_CAMERA_ATRACE();
@@ -803,44 +923,52 @@ int MediaControl::setSelection(int cameraId, const McFormat* format, int targetW
     LOG1("<id%d> @%s, targetWidth:%d, targetHeight:%d", cameraId, __func__, targetWidth,
          targetHeight);
 
+    struct v4l2_subdev_selection selection = {};
+    selection.pad = format->pad;
+    selection.which = V4L2_SUBDEV_FORMAT_ACTIVE;
+    selection.target = format->selCmd;
+    selection.flags = 0;
     if (format->top != -1 && format->left != -1 && format->width != 0 && format->height != 0) {
-        struct v4l2_subdev_selection selection = {};
-        selection.pad = format->pad;
-        selection.which = V4L2_SUBDEV_FORMAT_ACTIVE;
-        selection.target = format->selCmd;
-        selection.flags = 0;
         selection.r.top = format->top;
         selection.r.left = format->left;
         selection.r.width = format->width;
         selection.r.height = format->height;
-
-        ret = subDev->SetSelection(selection);
     } else if (format->selCmd == V4L2_SEL_TGT_CROP || format->selCmd == V4L2_SEL_TGT_COMPOSE) {
-        struct v4l2_subdev_selection selection = {};
-        selection.pad = format->pad;
-        selection.which = V4L2_SUBDEV_FORMAT_ACTIVE;
-        selection.target = format->selCmd;
-        selection.flags = 0;
         selection.r.top = 0;
         selection.r.left = 0;
         selection.r.width = targetWidth;
         selection.r.height = targetHeight;
-
-        ret = subDev->SetSelection(selection);
     } else {
         ret = BAD_VALUE;
     }
 
+    std::tuple<int, int, int> padKey(format->entity, format->pad, format->selCmd);
+    auto padSelection = mPadSelections.find(padKey);
+    if (ret == OK && mPipelineCached && padSelection != mPadSelections.end() &&
+        memcmp(&padSelection->second, &selection.r, sizeof(selection.r)) == 0) {
+        LOG1("selection %s [%d:%d] selCmd: %d is already set", format->entityName.c_str(),
+             format->entity, format->pad, format->selCmd);
+        return OK;
+    }
+
+    if (ret == OK) ret = subDev->SetSelection(selection);
+    if (ret < 0) mPadSelections.erase(padKey);
     CheckAndLogError(ret < 0, BAD_VALUE,
                      "set selection %s [%d:%d] selCmd: %d [%d, %d] [%dx%d] failed",
                      format->entityName.c_str(), format->entity, format->pad, format->selCmd,
                      format->top, format->left, format->width, format->height);
+    if (!(entity->pads[format->pad].flags & MEDIA_PAD_FL_SOURCE)) {
+        dropResetPadCache(entity, format->pad, format->selCmd);
+    }
+    mPadSelections[padKey] = selection.r;
 
     return OK;
 }
 
 int MediaControl::mediaCtlSetup(int cameraId, MediaCtlConf* mc, int width, int height, int field) {
     LOG1("<id%d> %s", cameraId, __func__);
+    AutoMutex l(mLinkLock);
+
     /* Setup controls in format Configuration */
     setMediaMcCtl(cameraId, mc->ctls);
 
@@ -862,15 +990,6 @@ int MediaControl::mediaCtlSetup(int cameraId, MediaCtlConf* mc, int width, int h
     }
     // VIRTUAL_CHANNEL_E
 
-    /* Set format & selection in format Configuration */
-    for (auto& fmt : mc->formats) {
-        if (fmt.formatType == FC_FORMAT) {
-            setFormat(cameraId, &fmt, width, height, field);
-        } else if (fmt.formatType == FC_SELECTION) {
-            setSelection(cameraId, &fmt, width, height);
-        }
-    }
-
     MediaEntity* ivsc = getEntityByName(ivscName.c_str());
     if (ivsc) {
         for (uint32_t i = 0; i < ivsc->numLinks; ++i) {
@@ -894,6 +1013,21 @@ int MediaControl::mediaCtlSetup(int cameraId, MediaCtlConf* mc, int width, int h
         }
     }
 
+    // Another process may have changed the shared entities since the last setup, so sync the
+    // link flags with the kernel and set all the formats again, they are only skipped when
+    // repeated within this setup
+    ret = refreshLinkFlags();
+    CheckAndLogError(ret < 0, ret, "Failed to get the link flags");
+
+    /* Set format & selection in format Configuration */
+    for (auto& fmt : mc->formats) {
+        if (fmt.formatType == FC_FORMAT) {
+            setFormat(cameraId, &fmt, width, height, field);
+        } else if (fmt.formatType == FC_SELECTION) {
+            setSelection(cameraId, &fmt, width, height);
+        }
+    }
+
     /* Set link in format Configuration */
     ret = setMediaMcLink(mc->links);
     CheckAndLogError(ret != OK, ret, "set MediaCtlConf McLink failed: ret = %d", ret);
@@ -922,6 +1056,10 @@ int MediaControl::getVCMI2CAddr(const char* vcmName, string* vcmI2CAddr) {
 
 void MediaControl::mediaCtlClear(int cameraId, MediaCtlConf* mc) {
     LOG1("<id%d> %s", cameraId, __func__);
+    AutoMutex l(mLinkLock);
+
+    // The pipeline may be changed by others after the camera is closed
+    mPipelineCached = false;
 
     // VIRTUAL_CHANNEL_S
     /* Clear routing */
@@ -29,7 +29,10 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <map>
 #include <string>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
 
 #ifdef CAL_BUILD
@@ -301,6 +304,8 @@ class MediaControl {
     int enumInfo();
     int enumLinks(int fd);
     int enumEntities(int fd, media_device_info& devInfo);
+    // sync the cached link flags with the kernel, and drop the cached formats
+    int refreshLinkFlags();
 
     // get entity info.
     int getDevnameFromSysfs(MediaEntity* entity);
@@ -310,6 +315,8 @@ class MediaControl {
     // set up entity link.
 
     MediaLink* entityAddLink(MediaEntity* entity);
+    MediaLink* findLink(uint32_t srcEntity, uint32_t srcPad, uint32_t sinkEntity,
+                        uint32_t sinkPad);
     int setupLink(uint32_t srcEntity, uint32_t srcPad, uint32_t sinkEntity, uint32_t sinkPad,
                   bool enable);
     int setupLink(MediaPad* source, MediaPad* sink, uint32_t flags);
@@ -320,6 +327,13 @@ class MediaControl {
     int setFormat(int cameraId, const McFormat* format, int targetWidth, int targetHeight,
                   int field);
     int setSelection(int cameraId, const McFormat* format, int targetWidth, int targetHeight);
+    /*
+     * The kernel resets the formats and selections of the source pads when the format or a
+     * selection of a sink pad is set, and resets the selections of the sink pad that follow
+     * the one set (format, crop, compose). Drop them from the cache so that they are set
+     * again. target is the selection target set, or -1 for the format.
+     */
+    void dropResetPadCache(const MediaEntity* entity, int sinkPad, int target);
 
     /* Dump functions */
     void dumpInfo(media_device_info& devInfo);
@@ -337,6 +351,23 @@ class MediaControl {
 
     std::string mDevName;
     std::vector<MediaEntity> mEntities;
+    // The index of the entities in mEntities
+    std::unordered_map<std::string, size_t> mEntityNameIndex;
+    std::unordered_map<uint32_t, size_t> mEntityIdIndex;
+
+    // Guard the links, routes and formats setup, which can be done by the cameras in parallel
+    Mutex mLinkLock;
+    /*
+     * The link flags in mEntities and the formats and selections below are what were set to the
+     * kernel, so the links already in the state and the repeated formats are skipped. Each setup
+     * syncs them with the kernel first, since the entities shared with the cameras of other
+     * processes may be changed by them at any time.
+     */
+    bool mPipelineCached;
+    // Key: entity, pad, stream
+    std::map<std::tuple<int, int, int>, v4l2_mbus_framefmt> mPadFormats;
+    // Key: entity, pad, selection target
+    std::map<std::tuple<int, int, int>, v4l2_rect> mPadSelections;
 
     static MediaControl* sInstance;
     static Mutex sLock;
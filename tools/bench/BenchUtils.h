@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2024 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * Helpers shared by the benchmark tools: the time, the memory and cpu usage of the process,
+ * and the latency percentiles. They are only used by the tools, not by the HAL.
+ */
+namespace bench {
+
+inline int64_t nowNs() {
+    struct timespec ts = {};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+inline long getRssKb() {
+    long pages = 0;
+    long rssPages = 0;
+    std::ifstream statm("/proc/self/statm");
+    if (!(statm >> pages >> rssPages)) return 0;
+
+    return rssPages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+struct ThreadCpuTime {
+    std::string name;
+    int64_t userMs;
+    int64_t sysMs;
+};
+
+// Key: thread id
+inline std::map<int, ThreadCpuTime> getThreadCpuTimes() {
+    std::map<int, ThreadCpuTime> times;
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) return times;
+
+    long ticksPerSec = sysconf(_SC_CLK_TCK);
+    struct dirent* entry = nullptr;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (entry->d_name[0] == '.') continue;
+
+        std::ifstream statFile(std::string("/proc/self/task/") + entry->d_name + "/stat");
+        std::string stat;
+        if (!std::getline(statFile, stat)) continue;
+
+        // The thread name is in parentheses and may contain spaces
+        size_t nameStart = stat.find('(');
+        size_t nameEnd = stat.rfind(')');
+        if (nameStart == std::string::npos || nameEnd == std::string::npos) continue;
+
+        // utime and stime are the 12th and 13th fields after the thread name
+        std::istringstream fields(stat.substr(nameEnd + 2));
+        std::string field;
+        int64_t utime = 0, stime = 0;
+        for (int i = 0; i < 11; i++) fields >> field;
+        if (!(fields >> utime >> stime)) continue;
+
+        ThreadCpuTime& time = times[atoi(entry->d_name)];
+        time.name = stat.substr(nameStart + 1, nameEnd - nameStart - 1);
+        time.userMs = utime * 1000 / ticksPerSec;
+        time.sysMs = stime * 1000 / ticksPerSec;
+    }
+    closedir(dir);
+
+    return times;
+}
+
+// Print the cpu time each thread used between the two snapshots
+inline void printThreadCpuTimes(const std::map<int, ThreadCpuTime>& before,
+                                const std::map<int, ThreadCpuTime>& after) {
+    printf("%-8s %-16s %10s %10s\n", "tid", "thread", "user(ms)", "sys(ms)");
+    for (auto& item : after) {
+        int64_t userMs = item.second.userMs;
+        int64_t sysMs = item.second.sysMs;
+        auto it = before.find(item.first);
+        if (it != before.end()) {
+            userMs -= it->second.userMs;
+            sysMs -= it->second.sysMs;
+        }
+        if (userMs == 0 && sysMs == 0) continue;
+
+        printf("%-8d %-16s %10ld %10ld\n", item.first, item.second.name.c_str(), userMs, sysMs);
+    }
+}
+
+class LatencyStats {
+ public:
+    void add(int64_t latencyUs) { mSamples.push_back(latencyUs); }
+    size_t count() const { return mSamples.size(); }
+
+    int64_t percentile(int percent) {
+        if (mSamples.empty()) return 0;
+
+        std::sort(mSamples.begin(), mSamples.end());
+        size_t index = std::min(mSamples.size() - 1, mSamples.size() * percent / 100);
+        return mSamples[index];
+    }
+
+    void print(const char* name) {
+        printf("%s: %zu samples, latency(us) p50 %ld p90 %ld p99 %ld max %ld\n", name,
+               mSamples.size(), percentile(50), percentile(90), percentile(99), percentile(100));
+    }
+
+ private:
+    std::vector<int64_t> mSamples;
+};
+
+}  // namespace bench
@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2024 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * aiq_post_bench: cpu time of the per-frame 3A result post-processing in AiqCore.
+ *
+ * Two steps are run on every frame with the manual tonemap or the lens shading map mode on:
+ *   tonemap: the gamma, sRGB or REC709 LUT of the gbce results. The baseline evaluates pow() for
+ *            each LUT entry as before the LUTs were cached, the HAL path is
+ *            AiqUtils::applyTonemapGamma/SRGB/REC709.
+ *   lsc:     the lens shading map resized to the metadata size. The baseline resizes the 4
+ *            channels with resize2dArray and interleaves them, the HAL path is
+ *            AiqUtils::resizeLscGridRGGB.
+ * The outputs of the baseline and the HAL path are compared, and the time per call and the
+ * saving per frame at the given fps are printed.
+ *
+ * Example:
+ *   aiq_post_bench -l 1024 -s 73x55 -d 64x48 -n 2000
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <string.h>
+
+#include <vector>
+
+#include "AiqUtils.h"
+#include "BenchUtils.h"
+
+using namespace icamera;
+
+// The calls of one sample, the time of a single call is too short for the timer
+static const int kCallsPerSample = 10;
+
+static void usage(const char* name) {
+    printf("Usage: %s [options]\n", name);
+    printf("  -l <size>     gamma lut size of the gbce results (default 1024)\n");
+    printf("  -s <WxH>      lens shading grid size from the ISP (default 73x55)\n");
+    printf("  -d <WxH>      lens shading map size of the metadata (default 64x48)\n");
+    printf("  -n <samples>  samples of each case, %d calls per sample (default 2000)\n",
+           kCallsPerSample);
+    printf("  -f <fps>      frame rate for the saving per second (default 30)\n");
+}
+
+enum TonemapType { TONEMAP_GAMMA = 0, TONEMAP_SRGB, TONEMAP_REC709 };
+
+// The LUT calculation of each frame before the LUTs were cached
+static void baselineTonemap(int type, float gamma, cca::cca_gbce_params* results) {
+    int lutSize = results->gamma_lut_size;
+    for (int i = 0; i < lutSize; i++) {
+        float in = i / static_cast<float>(type == TONEMAP_GAMMA ? lutSize : lutSize - 1);
+        if (type == TONEMAP_SRGB) {
+            results->g_gamma_lut[i] =
+                in < 0.0031308 ? 12.92 * in : 1.055 * pow(in, 1 / 2.4) - 0.055;
+        } else if (type == TONEMAP_REC709) {
+            results->g_gamma_lut[i] = in < 0.018 ? 4.5 * in : 1.099 * pow(in, 0.45) - 0.099;
+        } else {
+            results->g_gamma_lut[i] = pow(in, 1 / gamma);
+        }
+    }
+
+    memcpy(results->b_gamma_lut, results->g_gamma_lut, lutSize * sizeof(float));
+    memcpy(results->r_gamma_lut, results->g_gamma_lut, lutSize * sizeof(float));
+}
+
+static void halTonemap(int type, float gamma, cca::cca_gbce_params* results) {
+    if (type == TONEMAP_SRGB) {
+        AiqUtils::applyTonemapSRGB(results);
+    } else if (type == TONEMAP_REC709) {
+        AiqUtils::applyTonemapREC709(results);
+    } else {
+        AiqUtils::applyTonemapGamma(gamma, results);
+    }
+}
+
+static bool sameTonemap(const cca::cca_gbce_params& a, const cca::cca_gbce_params& b) {
+    size_t size = a.gamma_lut_size * sizeof(float);
+    return memcmp(a.r_gamma_lut, b.r_gamma_lut, size) == 0 &&
+           memcmp(a.g_gamma_lut, b.g_gamma_lut, size) == 0 &&
+           memcmp(a.b_gamma_lut, b.b_gamma_lut, size) == 0;
+}
+
+struct LscGrids {
+    int srcWidth, srcHeight, dstWidth, dstHeight;
+    std::vector<uint16_t> src[4];
+    std::vector<uint16_t> resized[4];
+};
+
+// The lens shading map storing of each frame before the resize was fused with the interleaving
+static void baselineLsc(LscGrids* grids, float* dst) {
+    for (int c = 0; c < 4; c++) {
+        AiqUtils::resize2dArray(grids->src[c].data(), grids->srcWidth, grids->srcHeight,
+                                grids->resized[c].data(), grids->dstWidth, grids->dstHeight);
+    }
+
+    size_t size = grids->dstWidth * grids->dstHeight;
+    for (size_t i = 0; i < size; i++) {
+        for (int c = 0; c < 4; c++) *dst++ = grids->resized[c][i];
+    }
+}
+
+static void halLsc(LscGrids* grids, float* dst) {
+    const uint16_t* channels[] = {grids->src[0].data(), grids->src[1].data(),
+                                  grids->src[2].data(), grids->src[3].data()};
+    AiqUtils::resizeLscGridRGGB(channels, grids->srcWidth, grids->srcHeight, dst,
+                                grids->dstWidth, grids->dstHeight);
+}
+
+// Time of one call in ns of each sample
+template <typename Func>
+static void runCase(Func func, int samples, bench::LatencyStats* stats) {
+    // Warm up the cache of the HAL path and the cpu caches
+    func();
+    for (int s = 0; s < samples; s++) {
+        int64_t start = bench::nowNs();
+        for (int i = 0; i < kCallsPerSample; i++) func();
+        stats->add((bench::nowNs() - start) / kCallsPerSample);
+    }
+}
+
+static void printCase(const char* name, bench::LatencyStats* baseline, bench::LatencyStats* hal,
+                      int fps) {
+    int64_t baselineNs = baseline->percentile(50);
+    int64_t halNs = hal->percentile(50);
+    printf("%-8s baseline p50 %8ld ns p99 %8ld ns | hal p50 %8ld ns p99 %8ld ns", name,
+           baselineNs, baseline->percentile(99), halNs, hal->percentile(99));
+    printf(" | saving %ld ns/frame, %.1f us/s at %d fps\n", baselineNs - halNs,
+           (baselineNs - halNs) * fps / 1000.0, fps);
+}
+
+int main(int argc, char* argv[]) {
+    int lutSize = 1024;
+    LscGrids grids = {73, 55, 64, 48};
+    int samples = 2000;
+    int fps = 30;
+
+    int opt = 0;
+    while ((opt = getopt(argc, argv, "l:s:d:n:f:h")) != -1) {
+        switch (opt) {
+            case 'l':
+                lutSize = atoi(optarg);
+                break;
+            case 's':
+                if (sscanf(optarg, "%dx%d", &grids.srcWidth, &grids.srcHeight) != 2) {
+                    usage(argv[0]);
+                    return -1;
+                }
+                break;
+            case 'd':
+                if (sscanf(optarg, "%dx%d", &grids.dstWidth, &grids.dstHeight) != 2) {
+                    usage(argv[0]);
+                    return -1;
+                }
+                break;
+            case 'n':
+                samples = atoi(optarg);
+                break;
+            case 'f':
+                fps = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : -1;
+        }
+    }
+
+    int maxLutSize = sizeof(cca::cca_gbce_params::g_gamma_lut) / sizeof(float);
+    if (lutSize < MIN_TONEMAP_POINTS || lutSize > maxLutSize || samples <= 0 || fps <= 0 ||
+        grids.srcWidth < 2 || grids.srcHeight < 2 || grids.dstWidth < 2 || grids.dstHeight < 2) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    bool ok = true;
+    printf("tonemap lut size %d, %d samples of %d calls\n", lutSize, samples, kCallsPerSample);
+    const char* tonemapNames[] = {"gamma", "srgb", "rec709"};
+    const float kGamma = 2.2;
+    for (int type = TONEMAP_GAMMA; type <= TONEMAP_REC709; type++) {
+        cca::cca_gbce_params baselineResults = {};
+        cca::cca_gbce_params halResults = {};
+        baselineResults.gamma_lut_size = lutSize;
+        halResults.gamma_lut_size = lutSize;
+
+        bench::LatencyStats baseline, hal;
+        runCase([&]() { baselineTonemap(type, kGamma, &baselineResults); }, samples, &baseline);
+        runCase([&]() { halTonemap(type, kGamma, &halResults); }, samples, &hal);
+        if (!sameTonemap(baselineResults, halResults)) {
+            printf("%s: the lut of the hal is different from the baseline\n", tonemapNames[type]);
+            ok = false;
+        }
+        printCase(tonemapNames[type], &baseline, &hal, fps);
+    }
+
+    // A smooth vignetting shape with some noise, like the grids from the ISP
+    size_t srcSize = grids.srcWidth * grids.srcHeight;
+    size_t dstSize = grids.dstWidth * grids.dstHeight;
+    srand(1);
+    for (int c = 0; c < 4; c++) {
+        grids.src[c].resize(srcSize);
+        grids.resized[c].resize(dstSize);
+        for (int y = 0; y < grids.srcHeight; y++) {
+            for (int x = 0; x < grids.srcWidth; x++) {
+                float dx = 2.0f * x / (grids.srcWidth - 1) - 1;
+                float dy = 2.0f * y / (grids.srcHeight - 1) - 1;
+                grids.src[c][y * grids.srcWidth + x] =
+                    4096 + 4096 * (dx * dx + dy * dy) + c * 64 + rand() % 32;
+            }
+        }
+    }
+
+    printf("lens shading map %dx%d to %dx%d\n", grids.srcWidth, grids.srcHeight, grids.dstWidth,
+           grids.dstHeight);
+    std::vector<float> baselineMap(dstSize * 4), halMap(dstSize * 4);
+    bench::LatencyStats baseline, hal;
+    runCase([&]() { baselineLsc(&grids, baselineMap.data()); }, samples, &baseline);
+    runCase([&]() { halLsc(&grids, halMap.data()); }, samples, &hal);
+    if (memcmp(baselineMap.data(), halMap.data(), baselineMap.size() * sizeof(float)) != 0) {
+        printf("lsc: the map of the hal is different from the baseline\n");
+        ok = false;
+    }
+    printCase("lsc", &baseline, &hal, fps);
+
+    return ok ? 0 : -1;
+}
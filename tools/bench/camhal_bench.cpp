@@ -0,0 +1,324 @@
+/*
+ * Copyright (C) 2024 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * camhal_bench: multi-camera stress and throughput benchmark through the ICamera API.
+ *
+ * It opens the cameras, configures the stream combination, and runs the qbuf/dqbuf loop of
+ * each camera in its own thread for a fixed duration. Then it reports the sustained fps and
+ * the qbuf to dqbuf latency percentiles of each stream, the cpu time of each thread and the
+ * RSS growth of the process.
+ *
+ * Without sensors, run it with FileSource injection (-i), the frames are then read from the
+ * given file or folder and paced at the -f fps.
+ *
+ * Example:
+ *   camhal_bench -c 0,1 -s preview:1280x720,video:1920x1080,still:1920x1080 -d 30
+ */
+
+#include <getopt.h>
+#include <linux/videodev2.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchUtils.h"
+#include "ICamera.h"
+#include "Parameters.h"
+
+using namespace icamera;
+
+struct StreamSpec {
+    std::string name;
+    int usage;
+    int format;
+    int width;
+    int height;
+};
+
+struct StreamResult {
+    int64_t frames;
+    bench::LatencyStats latency;
+};
+
+struct CameraResult {
+    int cameraId;
+    int ret;
+    int64_t durationNs;
+    std::vector<StreamResult> streams;
+};
+
+static void usage(const char* name) {
+    printf("Usage: %s [options]\n", name);
+    printf("  -c <ids>      camera ids, e.g. 0,1,2 (default 0)\n");
+    printf("  -s <streams>  stream list <usage>:<width>x<height>, the usage is one of\n");
+    printf("                preview, video, still and raw\n");
+    printf("                (default preview:1280x720,video:1920x1080)\n");
+    printf("  -d <seconds>  duration of the qbuf/dqbuf loop (default 10)\n");
+    printf("  -b <count>    buffers per stream (default 6)\n");
+    printf("  -r <fourcc>   format of the raw stream (default BG10)\n");
+    printf("  -i <file>     inject the frames from the file or folder (FileSource)\n");
+    printf("  -f <fps>      fps of the injected frames, 0 for as fast as possible\n");
+}
+
+static bool parseStreams(const char* arg, int rawFormat, std::vector<StreamSpec>* specs) {
+    std::stringstream list(arg);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        StreamSpec spec = {};
+        char name[16] = {};
+        if (sscanf(item.c_str(), "%15[^:]:%dx%d", name, &spec.width, &spec.height) != 3) {
+            return false;
+        }
+
+        spec.name = name;
+        spec.format = V4L2_PIX_FMT_NV12;
+        if (spec.name == "preview") {
+            spec.usage = CAMERA_STREAM_PREVIEW;
+        } else if (spec.name == "video") {
+            spec.usage = CAMERA_STREAM_VIDEO_CAPTURE;
+        } else if (spec.name == "still") {
+            spec.usage = CAMERA_STREAM_STILL_CAPTURE;
+        } else if (spec.name == "raw") {
+            spec.usage = CAMERA_STREAM_OPAQUE_RAW;
+            spec.format = rawFormat;
+        } else {
+            return false;
+        }
+        specs->push_back(spec);
+    }
+
+    return !specs->empty();
+}
+
+// Run the qbuf/dqbuf loop of one camera, the camera is opened and configured already
+static void runCamera(int cameraId, const std::vector<stream_t>& streams, int bufferCount,
+                      int64_t durationNs, CameraResult* result) {
+    size_t streamCount = streams.size();
+    result->streams.resize(streamCount);
+    for (auto& stream : result->streams) stream.frames = 0;
+
+    // buffers[stream][slot]
+    std::vector<std::vector<camera_buffer_t>> buffers(streamCount);
+    std::vector<std::vector<int64_t>> queueTimes(streamCount);
+    for (size_t s = 0; s < streamCount; s++) {
+        int bpp = 0;
+        int size = get_frame_size(cameraId, streams[s].format, streams[s].width,
+                                  streams[s].height, V4L2_FIELD_ANY, &bpp);
+        buffers[s].resize(bufferCount);
+        queueTimes[s].resize(bufferCount, 0);
+        for (auto& buffer : buffers[s]) {
+            memset(&buffer, 0, sizeof(buffer));
+            buffer.s = streams[s];
+            if (result->ret == 0 &&
+                (size <= 0 || posix_memalign(&buffer.addr, getpagesize(), size) != 0)) {
+                printf("camera %d: failed to allocate %d bytes for stream %zu\n", cameraId,
+                       size, s);
+                result->ret = -1;
+            }
+        }
+    }
+
+    // slots[stream], the slot of each stream queued in the next request
+    std::vector<int> slots(streamCount);
+    std::vector<camera_buffer_t*> request(streamCount);
+    auto queueRequest = [&]() {
+        for (size_t s = 0; s < streamCount; s++) {
+            request[s] = &buffers[s][slots[s]];
+            queueTimes[s][slots[s]] = bench::nowNs();
+        }
+        return camera_stream_qbuf(cameraId, request.data(), streamCount);
+    };
+
+    for (int slot = 0; slot < bufferCount && result->ret == 0; slot++) {
+        slots.assign(streamCount, slot);
+        result->ret = queueRequest();
+    }
+    bool started = false;
+    if (result->ret == 0) {
+        result->ret = camera_device_start(cameraId);
+        started = (result->ret == 0);
+    }
+
+    int64_t startTime = bench::nowNs();
+    while (result->ret == 0 && bench::nowNs() - startTime < durationNs) {
+        for (size_t s = 0; s < streamCount; s++) {
+            camera_buffer_t* buffer = nullptr;
+            result->ret = camera_stream_dqbuf(cameraId, streams[s].id, &buffer);
+            if (result->ret != 0 || !buffer) break;
+
+            // The streams may return their buffers out of the queued order, so each stream
+            // queues back the buffer it got
+            int slot = buffer - buffers[s].data();
+            if (slot < 0 || slot >= bufferCount) {
+                printf("camera %d: unknown buffer %p of stream %zu\n", cameraId, buffer, s);
+                result->ret = -1;
+                break;
+            }
+            result->streams[s].latency.add((bench::nowNs() - queueTimes[s][slot]) / 1000);
+            result->streams[s].frames++;
+            slots[s] = slot;
+        }
+        if (result->ret == 0) result->ret = queueRequest();
+    }
+    result->durationNs = bench::nowNs() - startTime;
+
+    if (started) camera_device_stop(cameraId);
+    for (auto& streamBuffers : buffers) {
+        for (auto& buffer : streamBuffers) free(buffer.addr);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<int> cameraIds;
+    const char* streamArg = "preview:1280x720,video:1920x1080";
+    int durationSec = 10;
+    int bufferCount = 6;
+    int rawFormat = V4L2_PIX_FMT_SBGGR10;
+
+    int opt = 0;
+    while ((opt = getopt(argc, argv, "c:s:d:b:r:i:f:h")) != -1) {
+        switch (opt) {
+            case 'c': {
+                std::stringstream list(optarg);
+                std::string id;
+                while (std::getline(list, id, ',')) cameraIds.push_back(atoi(id.c_str()));
+            } break;
+            case 's':
+                streamArg = optarg;
+                break;
+            case 'd':
+                durationSec = atoi(optarg);
+                break;
+            case 'b':
+                bufferCount = atoi(optarg);
+                break;
+            case 'r':
+                if (strlen(optarg) != 4) {
+                    usage(argv[0]);
+                    return -1;
+                }
+                rawFormat = v4l2_fourcc(optarg[0], optarg[1], optarg[2], optarg[3]);
+                break;
+            case 'i':
+                setenv("cameraInjectFile", optarg, 1);
+                break;
+            case 'f':
+                setenv("cameraInjectFps", optarg, 1);
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : -1;
+        }
+    }
+    if (cameraIds.empty()) cameraIds.push_back(0);
+
+    std::vector<StreamSpec> specs;
+    if (!parseStreams(streamArg, rawFormat, &specs) || durationSec <= 0 || bufferCount <= 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    long startRssKb = bench::getRssKb();
+    int ret = camera_hal_init();
+    if (ret != 0) {
+        printf("camera_hal_init failed %d\n", ret);
+        return ret;
+    }
+
+    std::vector<std::vector<stream_t>> cameraStreams(cameraIds.size());
+    for (size_t i = 0; i < cameraIds.size() && ret == 0; i++) {
+        int cameraId = cameraIds[i];
+        ret = camera_device_open(cameraId);
+        if (ret != 0) {
+            printf("camera %d: open failed %d\n", cameraId, ret);
+            cameraIds.resize(i);
+            break;
+        }
+
+        std::vector<stream_t>& streams = cameraStreams[i];
+        for (auto& spec : specs) {
+            stream_t stream = {};
+            stream.format = spec.format;
+            stream.width = spec.width;
+            stream.height = spec.height;
+            stream.field = V4L2_FIELD_ANY;
+            stream.memType = V4L2_MEMORY_USERPTR;
+            stream.usage = spec.usage;
+            stream.streamType = CAMERA_STREAM_OUTPUT;
+            streams.push_back(stream);
+        }
+        stream_config_t config = {};
+        config.num_streams = streams.size();
+        config.streams = streams.data();
+        config.operation_mode = CAMERA_STREAM_CONFIGURATION_MODE_AUTO;
+        ret = camera_device_config_streams(cameraId, &config);
+        if (ret != 0) printf("camera %d: config streams failed %d\n", cameraId, ret);
+    }
+    long configuredRssKb = bench::getRssKb();
+
+    std::vector<CameraResult> results(cameraIds.size());
+    if (ret == 0) {
+        std::map<int, bench::ThreadCpuTime> cpuBefore = bench::getThreadCpuTimes();
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < cameraIds.size(); i++) {
+            results[i].cameraId = cameraIds[i];
+            results[i].ret = 0;
+            results[i].durationNs = 0;
+            threads.push_back(std::thread(runCamera, cameraIds[i], cameraStreams[i],
+                                          bufferCount, durationSec * 1000000000LL,
+                                          &results[i]));
+        }
+        // Take the cpu time while the loops are still running, the cpu time of a thread is gone
+        // once it exits
+        std::this_thread::sleep_for(std::chrono::seconds(durationSec));
+        std::map<int, bench::ThreadCpuTime> cpuAfter = bench::getThreadCpuTimes();
+        long runRssKb = bench::getRssKb();
+        for (auto& thread : threads) thread.join();
+
+        for (size_t i = 0; i < results.size(); i++) {
+            CameraResult& result = results[i];
+            printf("camera %d: %s, %.2fs\n", result.cameraId, result.ret == 0 ? "ok" : "failed",
+                   result.durationNs / 1000000000.0);
+            for (size_t s = 0; s < result.streams.size(); s++) {
+                StreamResult& stream = result.streams[s];
+                double fps = result.durationNs > 0
+                                 ? stream.frames * 1000000000.0 / result.durationNs
+                                 : 0;
+                std::string name = "  " + specs[s].name;
+                printf("  %s %dx%d: %ld frames, %.2f fps\n", specs[s].name.c_str(),
+                       specs[s].width, specs[s].height, stream.frames, fps);
+                stream.latency.print(name.c_str());
+            }
+        }
+        printf("rss(KB): start %ld, configured %ld, after run %ld, growth in run %ld\n",
+               startRssKb, configuredRssKb, runRssKb, runRssKb - configuredRssKb);
+        bench::printThreadCpuTimes(cpuBefore, cpuAfter);
+    }
+
+    for (int cameraId : cameraIds) camera_device_close(cameraId);
+    camera_hal_deinit();
+
+    for (auto& result : results) {
+        if (result.ret != 0) return result.ret;
+    }
+    return ret;
+}
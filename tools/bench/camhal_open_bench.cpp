@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2024 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * camhal_open_bench: wall time of opening (and configuring) several cameras one by one and
+ * concurrently through the ICamera API, and the HAL init time and RSS.
+ *
+ * Each round opens the cameras sequentially, closes them, and then opens them from one thread
+ * per camera started at the same time. With the per-camera locks in CameraHal the concurrent
+ * wall time should be close to the slowest single open instead of the sum of them.
+ *
+ * Without sensors, run it with FileSource injection (-i), no frame is needed to be read since
+ * the cameras are not started.
+ *
+ * The RSS is printed before camera_hal_init(), after it and with all the cameras opened in the
+ * first round. The init maps the aiqb of the default tuning mode of each camera, the configure
+ * maps the others. The cameras sharing a tuning file share its mapped pages, so the RSS only
+ * grows with the pages the CCA touches.
+ *
+ * Example:
+ *   camhal_open_bench -c 0,1,2,3 -s 1920x1080 -n 10 -i /data/frames
+ */
+
+#include <getopt.h>
+#include <linux/videodev2.h>
+#include <stdlib.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchUtils.h"
+#include "ICamera.h"
+#include "Parameters.h"
+
+using namespace icamera;
+
+struct OpenResult {
+    bool opened;
+    int ret;
+    int64_t openUs;
+    int64_t configUs;
+};
+
+static void usage(const char* name) {
+    printf("Usage: %s [options]\n", name);
+    printf("  -c <ids>      camera ids, e.g. 0,1,2,3 (default 0,1,2,3)\n");
+    printf("  -s <WxH>      configure a NV12 preview stream after open, e.g. 1920x1080\n");
+    printf("                (default: open only)\n");
+    printf("  -n <rounds>   rounds of sequential and concurrent open (default 5)\n");
+    printf("  -i <file>     inject the frames from the file or folder (FileSource)\n");
+}
+
+// Open the camera and configure the stream if the width is set
+static void openCamera(int cameraId, int width, int height, OpenResult* result) {
+    int64_t start = bench::nowNs();
+    result->ret = camera_device_open(cameraId);
+    result->openUs = (bench::nowNs() - start) / 1000;
+    result->opened = (result->ret == 0);
+    result->configUs = 0;
+    if (result->ret != 0 || width <= 0) return;
+
+    stream_t stream = {};
+    stream.format = V4L2_PIX_FMT_NV12;
+    stream.width = width;
+    stream.height = height;
+    stream.field = V4L2_FIELD_ANY;
+    stream.memType = V4L2_MEMORY_USERPTR;
+    stream.usage = CAMERA_STREAM_PREVIEW;
+    stream.streamType = CAMERA_STREAM_OUTPUT;
+    stream_config_t config = {};
+    config.num_streams = 1;
+    config.streams = &stream;
+    config.operation_mode = CAMERA_STREAM_CONFIGURATION_MODE_AUTO;
+
+    start = bench::nowNs();
+    result->ret = camera_device_config_streams(cameraId, &config);
+    result->configUs = (bench::nowNs() - start) / 1000;
+}
+
+static void closeCameras(const std::vector<int>& cameraIds,
+                         const std::vector<OpenResult>& results) {
+    for (size_t i = 0; i < cameraIds.size(); i++) {
+        if (results[i].opened) camera_device_close(cameraIds[i]);
+    }
+}
+
+static bool checkResults(const char* name, const std::vector<int>& cameraIds,
+                         const std::vector<OpenResult>& results) {
+    bool ok = true;
+    for (size_t i = 0; i < cameraIds.size(); i++) {
+        if (results[i].ret != 0) {
+            printf("%s: camera %d failed %d\n", name, cameraIds[i], results[i].ret);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<int> cameraIds;
+    int width = 0;
+    int height = 0;
+    int rounds = 5;
+
+    int opt = 0;
+    while ((opt = getopt(argc, argv, "c:s:n:i:h")) != -1) {
+        switch (opt) {
+            case 'c': {
+                std::stringstream list(optarg);
+                std::string id;
+                while (std::getline(list, id, ',')) cameraIds.push_back(atoi(id.c_str()));
+            } break;
+            case 's':
+                if (sscanf(optarg, "%dx%d", &width, &height) != 2) {
+                    usage(argv[0]);
+                    return -1;
+                }
+                break;
+            case 'n':
+                rounds = atoi(optarg);
+                break;
+            case 'i':
+                setenv("cameraInjectFile", optarg, 1);
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : -1;
+        }
+    }
+    if (cameraIds.empty()) cameraIds = {0, 1, 2, 3};
+    if (rounds <= 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    long rssStartKb = bench::getRssKb();
+    int64_t start = bench::nowNs();
+    int ret = camera_hal_init();
+    int64_t initUs = (bench::nowNs() - start) / 1000;
+    if (ret != 0) {
+        printf("camera_hal_init failed %d\n", ret);
+        return ret;
+    }
+    long rssInitKb = bench::getRssKb();
+    long rssOpenKb = 0;
+
+    size_t cameraCount = cameraIds.size();
+    bench::LatencyStats sequentialWall, concurrentWall;
+    std::vector<bench::LatencyStats> sequentialOpen(cameraCount), concurrentOpen(cameraCount);
+    std::vector<bench::LatencyStats> sequentialConfig(cameraCount), concurrentConfig(cameraCount);
+    bool ok = true;
+    for (int round = 0; round < rounds && ok; round++) {
+        std::vector<OpenResult> results(cameraCount);
+
+        // Sequential
+        start = bench::nowNs();
+        for (size_t i = 0; i < cameraCount; i++) {
+            openCamera(cameraIds[i], width, height, &results[i]);
+        }
+        sequentialWall.add((bench::nowNs() - start) / 1000);
+        if (round == 0) rssOpenKb = bench::getRssKb();
+        closeCameras(cameraIds, results);
+        ok = checkResults("sequential", cameraIds, results);
+        for (size_t i = 0; i < cameraCount; i++) {
+            sequentialOpen[i].add(results[i].openUs);
+            sequentialConfig[i].add(results[i].configUs);
+        }
+        if (!ok) break;
+
+        // Concurrent, the threads wait for each other so that the opens start together
+        std::mutex lock;
+        std::condition_variable readySignal;
+        size_t readyCount = 0;
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < cameraCount; i++) {
+            threads.push_back(std::thread([&, i]() {
+                {
+                    std::unique_lock<std::mutex> l(lock);
+                    readyCount++;
+                    readySignal.notify_all();
+                    readySignal.wait(l, [&]() { return readyCount == cameraCount; });
+                }
+                openCamera(cameraIds[i], width, height, &results[i]);
+            }));
+        }
+        {
+            std::unique_lock<std::mutex> l(lock);
+            readySignal.wait(l, [&]() { return readyCount == cameraCount; });
+            start = bench::nowNs();
+        }
+        for (auto& thread : threads) thread.join();
+        concurrentWall.add((bench::nowNs() - start) / 1000);
+        closeCameras(cameraIds, results);
+        ok = checkResults("concurrent", cameraIds, results);
+        for (size_t i = 0; i < cameraCount; i++) {
+            concurrentOpen[i].add(results[i].openUs);
+            concurrentConfig[i].add(results[i].configUs);
+        }
+    }
+
+    if (ok) {
+        printf("%zu camera(s), %d round(s), %s\n", cameraCount, rounds,
+               width > 0 ? "open and configure" : "open only");
+        printf("camera_hal_init %ld us, rss(kB) start %ld, after init %ld, cameras opened %ld\n",
+               initUs, rssStartKb, rssInitKb, rssOpenKb);
+        for (size_t i = 0; i < cameraCount; i++) {
+            std::string name = "camera " + std::to_string(cameraIds[i]);
+            sequentialOpen[i].print((name + " sequential open").c_str());
+            concurrentOpen[i].print((name + " concurrent open").c_str());
+            if (width > 0) {
+                sequentialConfig[i].print((name + " sequential config").c_str());
+                concurrentConfig[i].print((name + " concurrent config").c_str());
+            }
+        }
+        sequentialWall.print("sequential wall time");
+        concurrentWall.print("concurrent wall time");
+        int64_t sequentialUs = sequentialWall.percentile(50);
+        int64_t concurrentUs = concurrentWall.percentile(50);
+        if (concurrentUs > 0) {
+            printf("speedup (p50): %.2fx\n", static_cast<double>(sequentialUs) / concurrentUs);
+        }
+    }
+
+    camera_hal_deinit();
+    return ok ? 0 : -1;
+}
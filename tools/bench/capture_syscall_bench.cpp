@@ -0,0 +1,442 @@
+/*
+ * Copyright (C) 2024 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * capture_syscall_bench: syscalls, buffer lock sections and cpu time per frame of the capture
+ * loop of CaptureUnit, against an emulated V4L2 backend installed with SysCall::updateInstance.
+ *
+ * The emulated video nodes produce a frame every 1/fps seconds when a buffer is queued, and drop
+ * it otherwise. The capture thread polls the nodes, dequeues the ready buffers, returns them to
+ * the pending queues and queues the pending buffers again, like the poll thread of CaptureUnit
+ * with the buffers returned at once by the consumers. Two cases are run:
+ *   round: the devices are checked before each round of queueBuffer(), the poll rebuilds the
+ *          device list, and queueBuffer() takes the buffer lock three times.
+ *   burst: the queueable rounds are worked out once and queued in a burst, the device list is
+ *          kept, and queueBuffer() takes the buffer lock twice, as CaptureUnit does now.
+ * V4L2 has no multi-buffer QBUF/DQBUF, so the ioctls per frame are the same in both cases.
+ *
+ * CaptureUnit itself isn't run: the V4L2 nodes of modules/v4l2 call ::ioctl() directly and
+ * DeviceBase needs the platform config, so the loop is replayed here against SysCall.
+ *
+ * Example:
+ *   capture_syscall_bench -f 120 -n 1200 -d 2 -b 4 -p 8
+ */
+
+#include <getopt.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "BenchUtils.h"
+#include "SysCall.h"
+
+using namespace icamera;
+
+// The fds of the emulated nodes start from here, so they don't clash with real fds
+static const int kFdBase = 1000;
+
+static void usage(const char* name) {
+    printf("Usage: %s [options]\n", name);
+    printf("  -f <fps>      frame rate of the emulated nodes (default 120)\n");
+    printf("  -n <frames>   frames of each case (default 1200)\n");
+    printf("  -d <devices>  capture devices polled together (default 2)\n");
+    printf("  -b <buffers>  max buffers queued in each device (default 4)\n");
+    printf("  -p <buffers>  buffers of each device (default 8)\n");
+}
+
+/**
+ * A V4L2 capture queue per fd. A frame is produced every interval, it fills the oldest queued
+ * buffer, or it's dropped when none is queued.
+ */
+class EmulatedSysCall : public SysCall {
+ public:
+    EmulatedSysCall(int nodeCount, int fps)
+            : mIntervalNs(1000000000LL / fps),
+              mIoctlCount(0),
+              mPollCount(0),
+              mNodes(nodeCount) {}
+
+    void start() {
+        int64_t now = bench::nowNs();
+        for (auto& node : mNodes) {
+            node.queued.clear();
+            node.done.clear();
+            node.nextFrameNs = now + mIntervalNs;
+            node.dropped = 0;
+        }
+        mIoctlCount = 0;
+        mPollCount = 0;
+    }
+
+    int ioctl(int fd, int request, struct v4l2_buffer* arg) override {
+        mIoctlCount++;
+        Node* node = getNode(fd);
+        if (!node || !arg) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        if (request == static_cast<int>(VIDIOC_QBUF)) {
+            node->queued.push_back(arg->index);
+            return 0;
+        }
+        if (request == static_cast<int>(VIDIOC_DQBUF)) {
+            updateFrames(bench::nowNs());
+            if (node->done.empty()) {
+                errno = EAGAIN;
+                return -1;
+            }
+            arg->index = node->done.front();
+            node->done.pop_front();
+            return 0;
+        }
+
+        errno = EINVAL;
+        return -1;
+    }
+
+    int poll(struct pollfd* pfd, nfds_t nfds, int timeout) override {
+        mPollCount++;
+        int64_t deadline = bench::nowNs() + static_cast<int64_t>(timeout) * 1000000;
+        while (true) {
+            int64_t now = bench::nowNs();
+            updateFrames(now);
+
+            int ready = 0;
+            int64_t nextFrameNs = deadline;
+            for (nfds_t i = 0; i < nfds; i++) {
+                Node* node = getNode(pfd[i].fd);
+                pfd[i].revents = 0;
+                if (!node) continue;
+                if (!node->done.empty()) {
+                    pfd[i].revents = POLLIN;
+                    ready++;
+                }
+                nextFrameNs = std::min(nextFrameNs, node->nextFrameNs);
+            }
+            if (ready > 0 || now >= deadline) return ready;
+
+            // Sleep until the next frame, like the driver wakes up the poll
+            int64_t sleepNs = std::max<int64_t>(nextFrameNs - now, 0);
+            struct timespec ts = {static_cast<time_t>(sleepNs / 1000000000),
+                                  static_cast<long>(sleepNs % 1000000000)};
+            nanosleep(&ts, nullptr);
+        }
+    }
+
+    int64_t getIoctlCount() const { return mIoctlCount; }
+    int64_t getPollCount() const { return mPollCount; }
+    int getDropped() const {
+        int dropped = 0;
+        for (auto& node : mNodes) dropped += node.dropped;
+        return dropped;
+    }
+
+ private:
+    struct Node {
+        std::deque<uint32_t> queued;
+        std::deque<uint32_t> done;
+        int64_t nextFrameNs;
+        int dropped;
+    };
+
+    Node* getNode(int fd) {
+        int index = fd - kFdBase;
+        if (index < 0 || index >= static_cast<int>(mNodes.size())) return nullptr;
+        return &mNodes[index];
+    }
+
+    void updateFrames(int64_t now) {
+        for (auto& node : mNodes) {
+            for (; node.nextFrameNs <= now; node.nextFrameNs += mIntervalNs) {
+                if (node.queued.empty()) {
+                    node.dropped++;
+                    continue;
+                }
+                node.done.push_back(node.queued.front());
+                node.queued.pop_front();
+            }
+        }
+    }
+
+    int64_t mIntervalNs;
+    int64_t mIoctlCount;
+    int64_t mPollCount;
+    std::vector<Node> mNodes;
+};
+
+// The buffer queues and the buffer lock of DeviceBase
+struct CaptureDevice {
+    int fd;
+    Mutex bufferLock;
+    std::deque<uint32_t> pendingBuffers;
+    std::deque<uint32_t> buffersInDevice;
+    bool bufferQueuing;
+};
+
+class CaptureLoop {
+ public:
+    CaptureLoop(int deviceCount, int maxBuffersInDevice, int bufferCount, bool burst)
+            : mMaxBuffersInDevice(maxBuffersInDevice),
+              mBurst(burst),
+              mLockCount(0),
+              mFrameCount(0) {
+        for (int i = 0; i < deviceCount; i++) {
+            std::unique_ptr<CaptureDevice> device(new CaptureDevice());
+            device->fd = kFdBase + i;
+            device->bufferQueuing = false;
+            for (int b = 0; b < bufferCount; b++) device->pendingBuffers.push_back(b);
+            mDevices.push_back(std::move(device));
+        }
+        for (auto& device : mDevices) mPollFds.push_back(device->fd);
+    }
+
+    // Queue the buffers before stream on, then capture the frames of the first device
+    int run(int frames) {
+        int ret = processPendingBuffers();
+        while (ret == 0 && mFrameCount < frames) {
+            ret = pollAndDequeue();
+        }
+        return ret;
+    }
+
+    int64_t getLockCount() const { return mLockCount; }
+    int getFrameCount() const { return mFrameCount; }
+
+ private:
+    int getPendingBufferNum(CaptureDevice* device) {
+        AutoMutex l(device->bufferLock);
+        mLockCount++;
+        return device->pendingBuffers.size();
+    }
+
+    int getBufferNumInDevice(CaptureDevice* device) {
+        AutoMutex l(device->bufferLock);
+        mLockCount++;
+        return device->buffersInDevice.size();
+    }
+
+    int queueBuffer(CaptureDevice* device) {
+        struct v4l2_buffer buf = {};
+        {
+            AutoMutex l(device->bufferLock);
+            mLockCount++;
+            if (device->bufferQueuing || device->pendingBuffers.empty()) return 0;
+            buf.index = device->pendingBuffers.front();
+            device->bufferQueuing = true;
+        }
+
+        int ret = SysCall::getInstance()->ioctl(device->fd, VIDIOC_QBUF, &buf);
+        {
+            AutoMutex l(device->bufferLock);
+            mLockCount++;
+            if (ret == 0) {
+                device->pendingBuffers.pop_front();
+                device->buffersInDevice.push_back(buf.index);
+            }
+            if (mBurst) device->bufferQueuing = false;
+        }
+        if (!mBurst) {
+            AutoMutex l(device->bufferLock);
+            mLockCount++;
+            device->bufferQueuing = false;
+        }
+        return ret;
+    }
+
+    int queueAllBuffers() {
+        for (auto& device : mDevices) {
+            int ret = queueBuffer(device.get());
+            if (ret != 0) return ret;
+        }
+        return 0;
+    }
+
+    int getQueueableRounds() {
+        int rounds = mMaxBuffersInDevice - getBufferNumInDevice(mDevices.front().get());
+        for (auto& device : mDevices) {
+            if (rounds <= 0) break;
+            rounds = std::min(rounds, getPendingBufferNum(device.get()));
+        }
+        return rounds;
+    }
+
+    int processPendingBuffers() {
+        if (mBurst) {
+            int rounds = getQueueableRounds();
+            while (rounds > 0) {
+                for (; rounds > 0; rounds--) {
+                    int ret = queueAllBuffers();
+                    if (ret != 0) return ret;
+                }
+                rounds = getQueueableRounds();
+            }
+            return 0;
+        }
+
+        while (getBufferNumInDevice(mDevices.front().get()) < mMaxBuffersInDevice) {
+            bool hasPendingBuffer = true;
+            for (auto& device : mDevices) {
+                if (getPendingBufferNum(device.get()) == 0) {
+                    hasPendingBuffer = false;
+                    break;
+                }
+            }
+            if (!hasPendingBuffer) break;
+
+            int ret = queueAllBuffers();
+            if (ret != 0) return ret;
+        }
+        return 0;
+    }
+
+    int pollAndDequeue() {
+        std::vector<int> pollFds;
+        if (mBurst) {
+            pollFds = mPollFds;
+        } else {
+            // The device list was rebuilt and logged with the buffer numbers on every wakeup
+            for (auto& device : mDevices) {
+                pollFds.push_back(device->fd);
+                getBufferNumInDevice(device.get());
+            }
+        }
+
+        std::vector<struct pollfd> pfds(pollFds.size());
+        for (size_t i = 0; i < pollFds.size(); i++) {
+            pfds[i].fd = pollFds[i];
+            pfds[i].events = POLLPRI | POLLIN | POLLOUT | POLLERR;
+        }
+        int ret = SysCall::getInstance()->poll(pfds.data(), pfds.size(), 1000);
+        if (ret <= 0) {
+            printf("poll failed or timed out %d\n", ret);
+            return -1;
+        }
+
+        for (size_t i = 0; i < pfds.size(); i++) {
+            if (!(pfds[i].revents & POLLIN)) continue;
+
+            CaptureDevice* device = mDevices[i].get();
+            struct v4l2_buffer buf = {};
+            ret = SysCall::getInstance()->ioctl(device->fd, VIDIOC_DQBUF, &buf);
+            if (ret != 0) return ret;
+            {
+                AutoMutex l(device->bufferLock);
+                mLockCount++;
+                device->buffersInDevice.pop_front();
+            }
+            if (i == 0) mFrameCount++;
+
+            // The consumers return the buffer at once
+            {
+                AutoMutex l(device->bufferLock);
+                mLockCount++;
+                device->pendingBuffers.push_back(buf.index);
+            }
+            ret = processPendingBuffers();
+            if (ret != 0) return ret;
+        }
+        return 0;
+    }
+
+    int mMaxBuffersInDevice;
+    bool mBurst;
+    int64_t mLockCount;
+    int mFrameCount;
+    std::vector<std::unique_ptr<CaptureDevice>> mDevices;
+    std::vector<int> mPollFds;
+};
+
+static int64_t getThreadCpuUs() {
+    struct timespec ts = {};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int runCase(const char* name, EmulatedSysCall* sysCall, int frames, int devices,
+                   int maxBuffersInDevice, int bufferCount, bool burst) {
+    CaptureLoop loop(devices, maxBuffersInDevice, bufferCount, burst);
+    sysCall->start();
+    int64_t cpuStart = getThreadCpuUs();
+    int ret = loop.run(frames);
+    int64_t cpuUs = getThreadCpuUs() - cpuStart;
+    if (ret != 0) {
+        printf("%s: capture loop failed %d\n", name, ret);
+        return ret;
+    }
+
+    double count = loop.getFrameCount();
+    printf("%-6s %d frames: ioctl %.2f, poll %.2f, lock %.2f per frame, cpu %.1f us per frame,"
+           " dropped %d\n",
+           name, loop.getFrameCount(), sysCall->getIoctlCount() / count,
+           sysCall->getPollCount() / count, loop.getLockCount() / count, cpuUs / count,
+           sysCall->getDropped());
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    int fps = 120;
+    int frames = 1200;
+    int devices = 2;
+    int maxBuffersInDevice = 4;
+    int bufferCount = 8;
+
+    int opt = 0;
+    while ((opt = getopt(argc, argv, "f:n:d:b:p:h")) != -1) {
+        switch (opt) {
+            case 'f':
+                fps = atoi(optarg);
+                break;
+            case 'n':
+                frames = atoi(optarg);
+                break;
+            case 'd':
+                devices = atoi(optarg);
+                break;
+            case 'b':
+                maxBuffersInDevice = atoi(optarg);
+                break;
+            case 'p':
+                bufferCount = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : -1;
+        }
+    }
+    if (fps <= 0 || frames <= 0 || devices <= 0 || maxBuffersInDevice <= 0 ||
+        bufferCount < maxBuffersInDevice) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    EmulatedSysCall sysCall(devices, fps);
+    SysCall::updateInstance(&sysCall);
+
+    printf("%d fps, %d devices, %d buffers in device, %d buffers\n", fps, devices,
+           maxBuffersInDevice, bufferCount);
+    int ret = runCase("round", &sysCall, frames, devices, maxBuffersInDevice, bufferCount, false);
+    if (ret == 0) {
+        ret = runCase("burst", &sysCall, frames, devices, maxBuffersInDevice, bufferCount, true);
+    }
+
+    SysCall::updateInstance(nullptr);
+    return ret;
+}
@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2024 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * cpu_tnr_bench: per-frame cost of the CPU TNR (IntelCpuTNR) against the plain frame copy
+ * which the pipeline does without TNR.
+ *
+ * NV12 frames of a noisy static scene with a moving block are fed to runTnrFrame() one by
+ * one, so both the static and the moving weights are used. The time of each frame, its share
+ * of the frame interval at the given fps and the cpu time of the TNR threads are printed.
+ * The AVX2 path is used when the cpu supports it, see the "avx2" of the init log.
+ *
+ * Example:
+ *   cpu_tnr_bench -s 1920x1080 -f 30 -n 300 -g 800
+ */
+
+#include <getopt.h>
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "BenchUtils.h"
+#include "modules/algowrapper/IntelTNR7US.h"
+
+using namespace icamera;
+
+// Input frames with different noise, fed in turn
+static const int kInputFrameCount = 8;
+static const int kBlockSize = 256;
+
+static void usage(const char* name) {
+    printf("Usage: %s [options]\n", name);
+    printf("  -s <WxH>      frame size (default 1920x1080)\n");
+    printf("  -f <fps>      frame rate for the budget share (default 30)\n");
+    printf("  -n <frames>   frames of each case (default 300)\n");
+    printf("  -g <gain>     total gain * 100 of the weight table (default 400)\n");
+}
+
+// A gradient with noise, and a block moved by 8 pixels per frame
+static void fillFrame(uint8_t* frame, int width, int height, int stride, int index) {
+    int blockX = (index * 8) % std::max(1, width - kBlockSize);
+    int blockY = height / 4;
+    for (int y = 0; y < height * 3 / 2; y++) {
+        uint8_t* line = frame + y * stride;
+        int imageY = y < height ? y : (y - height) * 2;
+        for (int x = 0; x < width; x++) {
+            int value = (x + imageY) * 255 / (width + height) + rand() % 9 - 4;
+            if (imageY >= blockY && imageY < blockY + kBlockSize && x >= blockX &&
+                x < blockX + kBlockSize) {
+                value = 235 - value / 2;
+            }
+            line[x] = static_cast<uint8_t>(std::min(255, std::max(0, value)));
+        }
+    }
+}
+
+static int64_t getCpuMs(const std::map<int, bench::ThreadCpuTime>& before,
+                        const std::map<int, bench::ThreadCpuTime>& after) {
+    int64_t cpuMs = 0;
+    for (auto& item : after) {
+        cpuMs += item.second.userMs + item.second.sysMs;
+        auto it = before.find(item.first);
+        if (it != before.end()) cpuMs -= it->second.userMs + it->second.sysMs;
+    }
+    return cpuMs;
+}
+
+static void printCase(const char* name, bench::LatencyStats* stats, int64_t cpuMs, int fps) {
+    stats->print(name);
+    double intervalUs = 1000000.0 / fps;
+    printf("%s: %.1f%% of the %d fps frame interval (p50), cpu %ld ms in %zu frames\n", name,
+           stats->percentile(50) * 100 / intervalUs, fps, cpuMs, stats->count());
+}
+
+int main(int argc, char* argv[]) {
+    int width = 1920;
+    int height = 1080;
+    int fps = 30;
+    int frames = 300;
+    int gain = 400;
+
+    int opt = 0;
+    while ((opt = getopt(argc, argv, "s:f:n:g:h")) != -1) {
+        switch (opt) {
+            case 's':
+                if (sscanf(optarg, "%dx%d", &width, &height) != 2) {
+                    usage(argv[0]);
+                    return -1;
+                }
+                break;
+            case 'f':
+                fps = atoi(optarg);
+                break;
+            case 'n':
+                frames = atoi(optarg);
+                break;
+            case 'g':
+                gain = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : -1;
+        }
+    }
+    if (width <= 0 || height <= 0 || (height % 2) || fps <= 0 || frames <= 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    std::unique_ptr<IntelCpuTNR> tnr(new IntelCpuTNR(0));
+    int ret = tnr->init(width, height);
+    if (ret != 0) {
+        printf("tnr init failed %d\n", ret);
+        return ret;
+    }
+    tnr->asyncParamUpdate(gain, true);
+
+    // The TNR takes the NV12 buffers without row padding
+    int stride = width;
+    uint32_t frameSize = stride * height * 3 / 2;
+    std::vector<void*> inputs;
+    srand(1);
+    for (int i = 0; i < kInputFrameCount; i++) {
+        void* buffer = tnr->allocCamBuf(frameSize, i);
+        if (!buffer) return -1;
+        fillFrame(static_cast<uint8_t*>(buffer), width, height, stride, i);
+        inputs.push_back(buffer);
+    }
+    void* output = tnr->allocCamBuf(frameSize, kInputFrameCount);
+    Tnr7Param* param = tnr->allocTnr7ParamBuf();
+    if (!output || !param) return -1;
+    memset(param, 0, sizeof(*param));
+
+    printf("%dx%d NV12, stride %d, %d frames, gain %d\n", width, height, stride, frames, gain);
+
+    // The first frame only restarts the reference, it isn't counted
+    param->bc.is_first_frame = 1;
+    tnr->runTnrFrame(inputs[0], output, frameSize, frameSize, param, true);
+    param->bc.is_first_frame = 0;
+
+    bench::LatencyStats tnrTime;
+    std::map<int, bench::ThreadCpuTime> cpuBefore = bench::getThreadCpuTimes();
+    for (int i = 0; i < frames && ret == 0; i++) {
+        int64_t start = bench::nowNs();
+        ret = tnr->runTnrFrame(inputs[(i + 1) % kInputFrameCount], output, frameSize, frameSize,
+                               param, true);
+        tnrTime.add((bench::nowNs() - start) / 1000);
+    }
+    int64_t tnrCpuMs = getCpuMs(cpuBefore, bench::getThreadCpuTimes());
+    if (ret != 0) {
+        printf("runTnrFrame failed %d\n", ret);
+        return ret;
+    }
+
+    bench::LatencyStats copyTime;
+    cpuBefore = bench::getThreadCpuTimes();
+    for (int i = 0; i < frames; i++) {
+        int64_t start = bench::nowNs();
+        memcpy(output, inputs[(i + 1) % kInputFrameCount], frameSize);
+        copyTime.add((bench::nowNs() - start) / 1000);
+    }
+    int64_t copyCpuMs = getCpuMs(cpuBefore, bench::getThreadCpuTimes());
+
+    printCase("tnr", &tnrTime, tnrCpuMs, fps);
+    printCase("copy", &copyTime, copyCpuMs, fps);
+    return 0;
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2024 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * gcss_parse_bench: parse time and resident memory of the graph descriptor and settings files.
+ *
+ * Every graph_settings_*.xml of each <config>/<platform>/gcss folder is taken as one camera,
+ * and parsed with the graph_descriptor.xml of the same folder in two modes:
+ *   per-camera: the descriptor and the settings are parsed for each camera, as before the
+ *               parsed graphs were shared.
+ *   shared:     GraphConfigImpl::parse() of each camera, the descriptor is parsed once per
+ *               folder and shared by the cameras.
+ * Each mode runs in its own process so that the RSS growth isn't hidden by the memory freed
+ * by the other mode.
+ *
+ * Example (from the source root):
+ *   gcss_parse_bench -p config/linux -n 5
+ */
+
+#include <dirent.h>
+#include <GCSSParser.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BenchUtils.h"
+#include "modules/algowrapper/graph/GraphConfigImpl.h"
+
+struct GcssFolder {
+    std::string descriptor;
+    std::vector<std::string> settings;
+};
+
+static void usage(const char* name) {
+    printf("Usage: %s [options]\n", name);
+    printf("  -p <path>     the config folder with <platform>/gcss (default config/linux)\n");
+    printf("  -n <rounds>   parse rounds of each mode (default 5)\n");
+}
+
+static std::vector<std::string> listDir(const std::string& path) {
+    std::vector<std::string> names;
+    DIR* dir = opendir(path.c_str());
+    if (!dir) return names;
+
+    struct dirent* entry = nullptr;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (entry->d_name[0] != '.') names.push_back(entry->d_name);
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+
+    return names;
+}
+
+static std::vector<GcssFolder> findGcssFolders(const std::string& configPath) {
+    std::vector<GcssFolder> folders;
+    for (auto& platform : listDir(configPath)) {
+        std::string gcssPath = configPath + "/" + platform + "/gcss/";
+        GcssFolder folder;
+        for (auto& file : listDir(gcssPath)) {
+            if (file == "graph_descriptor.xml") {
+                folder.descriptor = gcssPath + file;
+            } else if (file.compare(0, 15, "graph_settings_") == 0) {
+                folder.settings.push_back(gcssPath + file);
+            }
+        }
+        if (!folder.descriptor.empty() && !folder.settings.empty()) folders.push_back(folder);
+    }
+
+    return folders;
+}
+
+// Return the parse time in us, or -1 if any file fails to be parsed
+static int64_t parsePerCamera(const std::vector<GcssFolder>& folders,
+                              std::vector<std::unique_ptr<GCSS::IGraphConfig>>* graphs) {
+    int64_t start = bench::nowNs();
+    for (auto& folder : folders) {
+        for (auto& settings : folder.settings) {
+            for (auto& file : {folder.descriptor, settings}) {
+                GCSS::GCSSParser parser;
+                GCSS::IGraphConfig* graph = nullptr;
+                parser.parseGCSSXmlFile(file.c_str(), &graph);
+                if (!graph) {
+                    printf("failed to parse %s\n", file.c_str());
+                    return -1;
+                }
+                graphs->push_back(std::unique_ptr<GCSS::IGraphConfig>(graph));
+            }
+        }
+    }
+
+    return (bench::nowNs() - start) / 1000;
+}
+
+static int64_t parseShared(const std::vector<GcssFolder>& folders,
+                           icamera::GraphConfigImpl* impl) {
+    int64_t start = bench::nowNs();
+    int cameraId = 0;
+    for (auto& folder : folders) {
+        for (auto& settings : folder.settings) {
+            if (impl->parse(cameraId++, folder.descriptor.c_str(), settings.c_str()) != 0) {
+                printf("failed to parse %s with %s\n", settings.c_str(),
+                       folder.descriptor.c_str());
+                return -1;
+            }
+        }
+    }
+
+    return (bench::nowNs() - start) / 1000;
+}
+
+static int runMode(bool shared, const std::vector<GcssFolder>& folders, int rounds) {
+    icamera::GraphConfigImpl impl;
+    impl.addCustomKeyMap();
+
+    bench::LatencyStats parseTime;
+    long rssGrowthKb = 0;
+    for (int round = 0; round < rounds; round++) {
+        long rssBeforeKb = bench::getRssKb();
+        std::vector<std::unique_ptr<GCSS::IGraphConfig>> graphs;
+        int64_t timeUs = shared ? parseShared(folders, &impl) : parsePerCamera(folders, &graphs);
+        if (timeUs < 0) return -1;
+
+        // The later rounds reuse the memory freed by the first one
+        if (round == 0) rssGrowthKb = bench::getRssKb() - rssBeforeKb;
+        parseTime.add(timeUs);
+        if (shared) impl.releaseGraphNodes();
+    }
+
+    printf("%-10s rss growth %ld KB, ", shared ? "shared" : "per-camera", rssGrowthKb);
+    parseTime.print("parse time");
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    std::string configPath = "config/linux";
+    int rounds = 5;
+
+    int opt = 0;
+    while ((opt = getopt(argc, argv, "p:n:h")) != -1) {
+        switch (opt) {
+            case 'p':
+                configPath = optarg;
+                break;
+            case 'n':
+                rounds = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : -1;
+        }
+    }
+    if (rounds <= 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    std::vector<GcssFolder> folders = findGcssFolders(configPath);
+    if (folders.empty()) {
+        printf("no gcss folder found in %s\n", configPath.c_str());
+        return -1;
+    }
+    size_t cameraCount = 0;
+    for (auto& folder : folders) {
+        printf("%s: %zu settings file(s)\n", folder.descriptor.c_str(), folder.settings.size());
+        cameraCount += folder.settings.size();
+    }
+    printf("%zu folder(s), %zu camera(s), %d round(s)\n", folders.size(), cameraCount, rounds);
+    fflush(stdout);
+
+    int ret = 0;
+    for (bool shared : {false, true}) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            int childRet = runMode(shared, folders, rounds);
+            fflush(stdout);
+            _exit(childRet == 0 ? 0 : 1);
+        }
+
+        int status = 0;
+        if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != 0) {
+            ret = -1;
+        }
+    }
+
+    return ret;
+}